@@ -1,27 +1,53 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define HEIGHT 50
 #define WIDTH 70
+#define TORUS 0 //1にすると上下左右の端がつながったトーラスになる
 
-int cell[HEIGHT][WIDTH];
+/*
+ * 盤面の周りに1マスずつ余白(ハロー)を付けて、一続きの配列に確保する。
+ * 余白は死んだセル(TORUSのときは反対側の端のコピー)なので、近傍を数えるときに範囲チェックがいらない。
+ * 次の世代は別のバッファに書き込み、ポインタを入れ替えるだけで世代を進める。
+ */
+#define STRIDE (WIDTH + 2)
+#define AT(g, i, j) ((g)[(size_t) ((i) + 1) * STRIDE + (size_t) ((j) + 1)])
+
+typedef unsigned char grid_t;
+
+grid_t *cell; //今の世代
+grid_t *cell_next; //次の世代の書き込み先
 
 void init_cells()
 {
     int i, j;
 
+    cell = (grid_t *) calloc((size_t) (HEIGHT + 2) * STRIDE, sizeof(grid_t));
+    cell_next = (grid_t *) calloc((size_t) (HEIGHT + 2) * STRIDE, sizeof(grid_t));
+    if (cell == NULL || cell_next == NULL) {
+        fprintf(stderr, "error: cannot allocate cells.\n");
+        exit(1);
+    }
+
     for (i = 0; i < HEIGHT; i++) {
         for (j = 0; j < WIDTH; j++) {
-            cell[i][j] = 0;
+            AT(cell, i, j) = 0;
         }
     }
 
-    cell[20][30] = 1;
-    cell[22][30] = 1;
-    cell[22][31] = 1;
-    cell[23][31] = 1;
-    cell[20][32] = 1;
+    AT(cell, 20, 30) = 1;
+    AT(cell, 22, 30) = 1;
+    AT(cell, 22, 31) = 1;
+    AT(cell, 23, 31) = 1;
+    AT(cell, 20, 32) = 1;
+}
+
+void delete_cells()
+{
+    free(cell);
+    free(cell_next);
 }
 
 void print_cells(FILE *fp)
@@ -32,7 +58,7 @@ void print_cells(FILE *fp)
 
     for (i = 0; i < HEIGHT; i++) {
         for (j = 0; j < WIDTH; j++) {
-            const char c = (cell[i][j] == 1) ? '#' : ' ';
+            const char c = (AT(cell, i, j) == 1) ? '#' : ' ';
             fputc(c, fp);
         }
         fputc('\n', fp);
@@ -42,41 +68,45 @@ void print_cells(FILE *fp)
     sleep(1);
 }
 
-int count_adjacent_cells(int i, int j)
+/* TORUSのとき、余白に反対側の端をコピーする */
+void wrap_halo(grid_t *g)
 {
-    int n = 0;
-    int k, l;
-    for (k = i - 1; k <= i + 1; k++) {
-        if (k < 0 || k >= HEIGHT) continue;
-        for (l = j - 1; l <= j + 1; l++) {
-            if (k == i && l == j) continue;
-            if (l < 0 || l >= WIDTH) continue;
-            n += cell[k][l];
-        }
+    int i;
+
+    for (i = 0; i < HEIGHT; i++) {
+        AT(g, i, -1) = AT(g, i, WIDTH - 1);
+        AT(g, i, WIDTH) = AT(g, i, 0);
     }
-    return n;
+    //角も含めて行ごとコピーする
+    memcpy(&AT(g, -1, -1), &AT(g, HEIGHT - 1, -1), STRIDE * sizeof(grid_t));
+    memcpy(&AT(g, HEIGHT, -1), &AT(g, 0, -1), STRIDE * sizeof(grid_t));
 }
 
 void update_cells()
 {
     int i, j;
-    int cell_next[HEIGHT][WIDTH];
-
-    for (i = 0; i < HEIGHT; i++) {
-        for (j = 0; j < WIDTH; j++) {
-            cell_next[i][j] = 0;
-            const int n = count_adjacent_cells(i, j);
-
-            /*  ???  */
 
-        }
+    if (TORUS) {
+        wrap_halo(cell);
     }
 
     for (i = 0; i < HEIGHT; i++) {
+        const grid_t *up = &AT(cell, i - 1, 0);
+        const grid_t *mid = &AT(cell, i, 0);
+        const grid_t *down = &AT(cell, i + 1, 0);
+        grid_t *next = &AT(cell_next, i, 0);
+        //分岐のない内側のループなので、コンパイラがベクトル化できる
         for (j = 0; j < WIDTH; j++) {
-            cell[i][j] = cell_next[i][j];
+            const int n = up[j - 1] + up[j] + up[j + 1]
+                        + mid[j - 1] + mid[j + 1]
+                        + down[j - 1] + down[j] + down[j + 1];
+            next[j] = (grid_t) ((n == 3) | (mid[j] & (n == 2)));
         }
     }
+
+    grid_t *tmp = cell;
+    cell = cell_next;
+    cell_next = tmp;
 }
 
 
@@ -99,5 +129,6 @@ int main()
         print_cells(fp);
     }
 
+    delete_cells();
     fclose(fp);
 }
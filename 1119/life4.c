@@ -13,64 +13,241 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
 
 int HEIGHT = 40;
 int WIDTH = 50;
-int THRESHOLD = 3; //感染する閾値
+int THRESHOLD = 3; //感染する閾値(体内の病原体の量は63で飽和するので、62以下にすること)
 int RANGE = 3; //ウィルスの拡散範囲
 double NORMAL_RATIO = 0.2; //人口密度
 double INFECTED_RATIO = 0.1; //全人口のうち、初期の感染者の割合
+int MOBILE = 0; //1にすると、毎世代すべての人がランダムに一歩移動する
+double SIM_RATE = 1.0; //1秒あたりに進める世代数(0なら全速力)
+double DISPLAY_RATE = 30.0; //1秒あたりに端末を書き換える最大の回数
+int VIEW_HEIGHT = 40; //端末に表示する範囲
+int VIEW_WIDTH = 100;
+/*
+ * 1にすると、感染者のクラスタの大きさの分布を記録する(1セルあたり4バイト余分に使う)。
+ * MOBILEと一緒に使うと、人が動いてクラスタが分裂しうるので毎世代全体を数え直す(遅い)。
+ */
+int TRACK_CLUSTERS = 0;
+
+/*
+ * 一つのセルの状態を1バイトに詰め込む。
+ * bit0: 人がいるか, bit1: 感染しているか, bit2-7: 体内の病原体の量(63で飽和)
+ * 10^9セルでもcellとfieldを合わせて2GB程度に収まる。
+ */
+typedef uint8_t state;
+
+#define PERSON_BIT   0x01
+#define INFECTED_BIT 0x02
+#define COUNT_SHIFT  2
+#define COUNT_MAX    63
+
+#define IS_PERSON(s)   ((s) & PERSON_BIT)
+#define IS_INFECTED(s) ((s) & INFECTED_BIT)
+#define COUNT(s)       ((s) >> COUNT_SHIFT)
+#define SET_COUNT(s, c) ((state) (((s) & (PERSON_BIT | INFECTED_BIT)) | ((c) << COUNT_SHIFT)))
 
-typedef struct {
-    int isPerson;
-    int isInfected;
-    int count;
-} state;
+#define CELL(i, j)  cell[(size_t) (i) * (size_t) WIDTH + (size_t) (j)]
+#define FIELD(i, j) field[(size_t) (i) * (size_t) WIDTH + (size_t) (j)]
 
-int** field; //その場所にどれくらいウィルスが存在するか
-state** cell; //その場所の人の状態
+uint8_t* field; //その場所にどれくらいウィルスが存在するか(255で飽和)
+state* cell; //その場所の人の状態
+state* cell_next; //移動後の人の状態(MOBILEのときのみ使う)
+int* hsum; //病原体の量を求めるときの、一行分の横方向の移動和
+int* colsum; //同じく、縦方向の移動和
+uint64_t move_seed; //移動方向を決める乱数の種
+unsigned long move_gen = 0; //移動した回数
+
+/*
+ * 感染者クラスタ(上下左右斜めに隣接する感染者の集まり)をunion-findで管理する。
+ * 感染者が回復することはないので、クラスタは合体するだけで分裂しない。
+ * そのため新しく感染した人をそのたびに隣の感染者と併合すれば、毎世代全体を数え直す必要がない。
+ * cluster_parent[k]は根なら-(クラスタの大きさ)、それ以外は親のセル番号(セル数は2^31未満とする)。
+ * 大きさの分布は2のべき乗ごとの区間(cluster_bins[b]は大きさが[2^b, 2^(b+1))のクラスタの数)で持ち、
+ * 併合のたびに更新するので、出力は区間の数だけの手間で済む。
+ */
+#define CLUSTER_BINS 32
+#define CLUSTER_NONE INT32_MAX //まだクラスタに入っていないセル
+
+int32_t* cluster_parent;
+long cluster_bins[CLUSTER_BINS];
+long cluster_count = 0; //クラスタの数
+long cluster_max = 0; //最大のクラスタの大きさ
 
 void init_cells();
 void delete_cells();
 void print_cells(FILE* fp);
+void move_people();
 void update_cells();
-int count_total_people();
-int count_infected_people();
+long count_total_people();
+long count_infected_people();
+void render_init();
+void render_delete();
 void show_data(int gen);
+void cluster_init();
+void cluster_delete();
+void cluster_add(size_t k);
+void print_clusters(FILE* fp, int gen);
 
 void init_cells() {
-    field = (int**) malloc(sizeof(int*) * (size_t) HEIGHT);
-    cell = (state**) malloc(sizeof(state*) * (size_t) HEIGHT);
-
-    int i, j;
-
-    for (i = 0; i < HEIGHT; i++) {
-        field[i] = (int*) malloc(sizeof(int) * (size_t) WIDTH);
-        cell[i] = (state*) malloc(sizeof(state) * (size_t) WIDTH);
-        for(j = 0; j < WIDTH; j++) {
-            cell[i][j].isPerson = 0;
-            cell[i][j].isInfected = 0;
-            cell[i][j].count = 0;
-        }
+    const size_t size = (size_t) HEIGHT * (size_t) WIDTH;
+    field = (uint8_t*) calloc(size, sizeof(uint8_t));
+    cell = (state*) calloc(size, sizeof(state));
+    cell_next = MOBILE ? (state*) calloc(size, sizeof(state)) : NULL;
+    hsum = (int*) malloc(sizeof(int) * (size_t) WIDTH);
+    colsum = (int*) malloc(sizeof(int) * (size_t) WIDTH);
+    if(field == NULL || cell == NULL || (MOBILE && cell_next == NULL) || hsum == NULL || colsum == NULL) {
+        fprintf(stderr, "error: cannot allocate cells.\n");
+        exit(1);
     }
 
-    for(int n = 0; n < WIDTH * HEIGHT * NORMAL_RATIO; n++) {
+    int i, j;
+    const double people = (double) size * NORMAL_RATIO;
+    for(long n = 0; n < people; n++) {
         i = rand() % HEIGHT;
         j = rand() % WIDTH;
-        cell[i][j].isPerson = 1;
+        CELL(i, j) |= PERSON_BIT;
         if((double) rand() / RAND_MAX < INFECTED_RATIO) {
-            cell[i][j].isInfected = 1;
+            CELL(i, j) |= INFECTED_BIT;
         }
     }
+    move_seed = ((uint64_t) rand() << 32) ^ (uint64_t) rand();
 }
 
 void delete_cells() {
-    for(int i = 0; i < HEIGHT; i++) {
-        free(field[i]);
-        free(cell[i]);
-    }
     free(field);
     free(cell);
+    free(cell_next);
+    free(hsum);
+    free(colsum);
+}
+
+/* 大きさsizeのクラスタが入る区間 */
+static int cluster_bin(long size)
+{
+    int b = 0;
+    while(size > 1) {
+        size >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static size_t cluster_find(size_t k)
+{
+    while(cluster_parent[k] >= 0) {
+        const int32_t p = cluster_parent[k];
+        if(cluster_parent[p] >= 0) {
+            cluster_parent[k] = cluster_parent[p]; //経路を半分に縮める
+        }
+        k = (size_t) p;
+    }
+    return k;
+}
+
+static void cluster_union(size_t a, size_t b)
+{
+    a = cluster_find(a);
+    b = cluster_find(b);
+    if(a == b) return;
+
+    long size_a = -cluster_parent[a];
+    long size_b = -cluster_parent[b];
+    if(size_a < size_b) { //小さい方を大きい方の下につなぐ
+        size_t tmp = a; a = b; b = tmp;
+    }
+    cluster_bins[cluster_bin(size_a)]--;
+    cluster_bins[cluster_bin(size_b)]--;
+    cluster_bins[cluster_bin(size_a + size_b)]++;
+    cluster_parent[a] = (int32_t) -(size_a + size_b);
+    cluster_parent[b] = (int32_t) a;
+    cluster_count--;
+    if(size_a + size_b > cluster_max) {
+        cluster_max = size_a + size_b;
+    }
+}
+
+/* セルkの人が感染したときに呼ぶ。隣接する感染者のクラスタと併合する */
+void cluster_add(size_t k)
+{
+    if(!TRACK_CLUSTERS) return;
+
+    cluster_parent[k] = -1;
+    cluster_bins[0]++;
+    cluster_count++;
+    if(cluster_max < 1) cluster_max = 1;
+
+    const int i = (int) (k / (size_t) WIDTH);
+    const int j = (int) (k % (size_t) WIDTH);
+    for(int di = -1; di <= 1; di++) {
+        if(i + di < 0 || i + di >= HEIGHT) continue;
+        for(int dj = -1; dj <= 1; dj++) {
+            if(di == 0 && dj == 0) continue;
+            if(j + dj < 0 || j + dj >= WIDTH) continue;
+            const size_t n = k + (size_t) ((long) di * WIDTH + dj);
+            //まだ処理していないセルの感染は、そのセルのcluster_addで併合される
+            if(IS_PERSON(cell[n]) && IS_INFECTED(cell[n]) && cluster_parent[n] != CLUSTER_NONE) {
+                cluster_union(k, n);
+            }
+        }
+    }
+}
+
+/* 盤面全体からクラスタを作り直す */
+void cluster_init()
+{
+    if(!TRACK_CLUSTERS) return;
+
+    const size_t size = (size_t) HEIGHT * (size_t) WIDTH;
+    if(cluster_parent == NULL) {
+        cluster_parent = (int32_t*) malloc(sizeof(int32_t) * size);
+        if(cluster_parent == NULL) {
+            fprintf(stderr, "error: cannot allocate clusters.\n");
+            exit(1);
+        }
+    }
+    for(size_t k = 0; k < size; k++) {
+        cluster_parent[k] = CLUSTER_NONE;
+    }
+    for(int b = 0; b < CLUSTER_BINS; b++) {
+        cluster_bins[b] = 0;
+    }
+    cluster_count = 0;
+    cluster_max = 0;
+
+    for(size_t k = 0; k < size; k++) {
+        if(IS_PERSON(cell[k]) && IS_INFECTED(cell[k])) {
+            cluster_add(k);
+        }
+    }
+}
+
+void cluster_delete()
+{
+    free(cluster_parent);
+    cluster_parent = NULL;
+}
+
+/* 世代, クラスタ数, 最大クラスタ, 区間ごとのクラスタ数 を一行で書き出す */
+void print_clusters(FILE* fp, int gen)
+{
+    if(!TRACK_CLUSTERS) return;
+
+    int last = CLUSTER_BINS - 1;
+    while(last > 0 && cluster_bins[last] == 0) {
+        last--;
+    }
+    fprintf(fp, "%d %ld %ld", gen, cluster_count, cluster_max);
+    for(int b = 0; b <= last; b++) {
+        fprintf(fp, " %ld", cluster_bins[b]);
+    }
+    fputc('\n', fp);
+    fflush(fp);
 }
 
 void print_cells(FILE *fp)
@@ -82,8 +259,8 @@ void print_cells(FILE *fp)
     for (i = 0; i < HEIGHT; i++) {
         for (j = 0; j < WIDTH; j++) {
             char c = ' ';
-            if(cell[i][j].isPerson) {
-                if(cell[i][j].isInfected) {
+            if(IS_PERSON(CELL(i, j))) {
+                if(IS_INFECTED(CELL(i, j))) {
                     c = '*';
                 } else {
                     c = '#';
@@ -96,92 +273,303 @@ void print_cells(FILE *fp)
     fflush(fp);
 }
 
-void show_data(int gen) {
+/* 時刻(秒)。フレームの間隔を測るのに使う */
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* 端末に今表示されている文字(' ', '#', '*') */
+static char* shown;
+static int legend_shown = 0;
+static int view_height, view_width;
+static char* out_buf; //1フレーム分の出力をまとめて書き出すためのバッファ
+static size_t out_len, out_cap;
+
+static void out_bytes(const char* str, size_t len)
+{
+    if(out_len + len > out_cap) {
+        out_cap = (out_len + len) * 2;
+        out_buf = (char*) realloc(out_buf, out_cap);
+        if(out_buf == NULL) {
+            fprintf(stderr, "error: cannot allocate the output buffer.\n");
+            exit(1);
+        }
+    }
+    for(size_t n = 0; n < len; n++) {
+        out_buf[out_len++] = str[n];
+    }
+}
+
+static void out_printf(const char* format, ...)
+{
+    char tmp[128];
+    va_list ap;
+    va_start(ap, format);
+    const int len = vsnprintf(tmp, sizeof(tmp), format, ap);
+    va_end(ap);
+    out_bytes(tmp, (size_t) len);
+}
+
+/* セルの文字に対応する色のエスケープシーケンス。空白は何色で書いても同じなのでNULL */
+static const char* color_of(char c)
+{
+    if(c == '*') return "\033[31m"; //red
+    if(c == '#') return "\033[32m"; //green
+    return NULL;
+}
+
+static void out_cell(char c, const char** color)
+{
+    const char* want = color_of(c);
+    if(want != NULL && want != *color) {
+        *color = want;
+        out_bytes(want, strlen(want));
+    }
+    out_bytes(&c, 1);
+}
+
+void render_init()
+{
+    view_height = HEIGHT < VIEW_HEIGHT ? HEIGHT : VIEW_HEIGHT;
+    view_width = WIDTH < VIEW_WIDTH ? WIDTH : VIEW_WIDTH;
+    shown = (char*) malloc((size_t) view_height * (size_t) view_width);
+    out_cap = (size_t) view_height * (size_t) view_width * 2 + 1024;
+    out_buf = (char*) malloc(out_cap);
+    if(shown == NULL || out_buf == NULL) {
+        fprintf(stderr, "error: cannot allocate the output buffer.\n");
+        exit(1);
+    }
+    memset(shown, ' ', (size_t) view_height * (size_t) view_width); //画面は消去するので空白から始まる
+
     printf("\033[1;1H"); //カーソルを左上に
     printf("\033[2J");
-    printf("generation = %d\n", gen);
-    printf("%d / %d people infected\n", count_infected_people(), count_total_people());
-    printf("\033[32m#\033[39m: healthy person. \033[31m*\033[39m: infected person.\n");
-    printf("--------------------\n");
-    for(int i = 0; i < HEIGHT; i++) {
-        for(int j = 0; j < WIDTH; j++) {
-            char c = ' ';
-            if(cell[i][j].isPerson) {
-                if(cell[i][j].isInfected) {
-                    c = '*';
-                    printf("\033[31m"); //red
-                } else {
-                    c = '#';
-                    printf("\033[32m"); //green
+    fflush(stdout);
+}
+
+void render_delete()
+{
+    free(shown);
+    free(out_buf);
+}
+
+/*
+ * 前回表示したフレームとの差分だけを端末に送る。
+ * 変化したセルの手前にだけカーソル移動を入れ、同じ色が続く間は色のエスケープを省く。
+ * 変化していないセルの隙間が短いときは、カーソル移動よりも上書きした方が短いのでそのまま書く。
+ */
+void show_data(int gen) {
+    const int top = 6; //盤面を描き始める行(1始まり)
+    const char* color = NULL; //端末の現在の色
+
+    out_len = 0;
+    out_printf("\033[1;1Hgeneration = %d\033[K\n", gen);
+    out_printf("%ld / %ld people infected\033[K\n", count_infected_people(), count_total_people());
+    if(TRACK_CLUSTERS) {
+        out_printf("%ld clusters, largest = %ld", cluster_count, cluster_max);
+        if(MOBILE) {
+            out_printf(" (relabelled every generation)");
+        }
+    }
+    out_printf("\033[K\n");
+    if(!legend_shown) {
+        out_printf("\033[32m#\033[39m: healthy person. \033[31m*\033[39m: infected person.\n");
+        out_printf("--------------------\n");
+        legend_shown = 1;
+    }
+
+    for(int i = 0; i < view_height; i++) {
+        int cursor = -1; //この行でのカーソルの列。-1は行の外
+        for(int j = 0; j < view_width; j++) {
+            const state s = CELL(i, j);
+            const char c = IS_PERSON(s) ? (IS_INFECTED(s) ? '*' : '#') : ' ';
+            char* prev = &shown[(size_t) i * (size_t) view_width + (size_t) j];
+            if(*prev == c) continue;
+
+            if(cursor < 0 || j - cursor > 4) {
+                out_printf("\033[%d;%dH", top + i, j + 1);
+            } else {
+                for(int l = cursor; l < j; l++) { //隙間はそのまま書き直す
+                    out_cell(shown[(size_t) i * (size_t) view_width + (size_t) l], &color);
                 }
             }
-            printf("%c", c);
-            printf("\033[39m"); //neutral color
+            out_cell(c, &color);
+            *prev = c;
+            cursor = j + 1;
         }
-        printf("\n");
     }
+    out_printf("\033[39m\033[%d;%dH", top + view_height, 1);
+
+    fwrite(out_buf, 1, out_len, stdout);
     fflush(stdout);
 }
 
-void update_cells()
+/* i行目の感染者を横方向に[j - RANGE, j + RANGE]の範囲で数え、hsumに書き込む */
+static void infected_row_sum(int i, int* hsum)
 {
-    int i, j;
+    const state* row = &CELL(i, 0);
+    int j, n = 0;
 
-    for(i = 0; i < HEIGHT; i++) {
-        for(j = 0; j < WIDTH; j++) {
-            field[i][j] = 0;
-        }
+    for(j = 0; j < RANGE && j < WIDTH; j++) {
+        n += IS_INFECTED(row[j]) ? 1 : 0;
     }
-    for(i = 0; i < HEIGHT; i++) {
-        for(j = 0; j < WIDTH; j++) {
-            if(cell[i][j].count > 0) { //だんだん病原菌が抜けていく
-                cell[i][j].count--;
-            }
-            if(cell[i][j].isInfected) {
-                for(int k = i - RANGE; k <= i + RANGE; k++) {
-                    if(k < 0 || k >= HEIGHT) continue;
-                    for(int l = j - RANGE; l <= j + RANGE; l++) {
-                        if(l < 0 || l >= WIDTH) continue;
-                        field[k][l]++;
-                    }
-                }
-            }
+    for(j = 0; j < WIDTH; j++) {
+        if(j + RANGE < WIDTH && IS_INFECTED(row[j + RANGE])) n++;
+        hsum[j] = n;
+        if(j - RANGE >= 0 && IS_INFECTED(row[j - RANGE])) n--;
+    }
+}
+
+/*
+ * 人の移動について
+ * 各人の移動方向は(種, 世代, セル番号)のハッシュだけで決まるので、どのセルからも独立に計算できる。
+ * 移動先は現在の盤面で空いているセルに限り、同じセルを複数人が狙った場合は
+ * 上、左、右、下の順で最初に見つかった人だけが移動できる(他の人はその場に留まる)。
+ * このルールなら各セルの次の状態は自分と上下左右の4セルを見るだけで決まるので、
+ * 移動先の盤面cell_nextをセルごとに並列に埋められる。
+ */
+static const int move_di[4] = {-1, 0, 0, 1}; //上, 左, 右, 下
+static const int move_dj[4] = {0, -1, 1, 0};
+
+/* セル番号kの人がこの世代に進もうとする方向(move_di, move_djの添字) */
+static int move_direction(size_t k)
+{
+    uint64_t z = move_seed + move_gen * 0x9e3779b97f4a7c15ULL + (uint64_t) k * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (int) (z >> 62);
+}
+
+/* 空いているセル(i, j)に移動してくる人のセル番号。いなければ-1 */
+static long mover_into(int i, int j)
+{
+    //(i, j)から見て上、左、右、下にいる人が、それぞれ下、右、左、上に進もうとしていれば入ってくる
+    for(int d = 0; d < 4; d++) {
+        const int si = i + move_di[d];
+        const int sj = j + move_dj[d];
+        if(si < 0 || si >= HEIGHT || sj < 0 || sj >= WIDTH) continue;
+        const size_t k = (size_t) si * (size_t) WIDTH + (size_t) sj;
+        if(IS_PERSON(cell[k]) && move_direction(k) == 3 - d) {
+            return (long) k;
         }
     }
+    return -1;
+}
+
+void move_people()
+{
+    int i, j;
 
+    //-fopenmpを付けてコンパイルしたときだけ行ごとに並列にする(付けなくても結果は同じ)
+#ifdef _OPENMP
+    #pragma omp parallel for private(j)
+#endif
     for(i = 0; i < HEIGHT; i++) {
         for(j = 0; j < WIDTH; j++) {
-            if(cell[i][j].isPerson) {
-                cell[i][j].count += field[i][j];
-                if(cell[i][j].count > THRESHOLD) {
-                    cell[i][j].isInfected = 1;
+            const size_t k = (size_t) i * (size_t) WIDTH + (size_t) j;
+            const state s = cell[k];
+            state next = s;
+            if(IS_PERSON(s)) {
+                const int d = move_direction(k);
+                const int ti = i + move_di[d];
+                const int tj = j + move_dj[d];
+                if(ti >= 0 && ti < HEIGHT && tj >= 0 && tj < WIDTH
+                   && !IS_PERSON(CELL(ti, tj)) && mover_into(ti, tj) == (long) k) {
+                    next = 0; //移動に成功したので、ここは空く
+                }
+            } else {
+                const long src = mover_into(i, j);
+                if(src >= 0) {
+                    next = cell[src]; //病原体の量ごと引っ越してくる
                 }
             }
+            cell_next[k] = next;
         }
     }
+
+    state* tmp = cell;
+    cell = cell_next;
+    cell_next = tmp;
+    move_gen++;
 }
 
-int count_total_people() {
-    int num = 0;
+void update_cells()
+{
     int i, j;
+
+    if(MOBILE) {
+        move_people(); //移動してから、新しい位置で感染を広げる
+        cluster_init(); //人が動くとクラスタは分裂しうるので、作り直す(TRACK_CLUSTERSのときだけ)
+    }
+
+    /*
+     * 感染者ごとに(2 * RANGE + 1)^2 マスへ加算する代わりに、
+     * 横方向の移動和と縦方向の移動和を組み合わせて、各セルの病原体量を一度に求める。
+     * RANGEによらず1セルあたり定数回のアクセスで済み、メモリも行方向に順番に舐める。
+     * 移動和の作業領域は盤面と一緒に確保しておき、毎世代使い回す。
+     */
+    memset(colsum, 0, sizeof(int) * (size_t) WIDTH);
+
+    for(i = 0; i < RANGE && i < HEIGHT; i++) {
+        infected_row_sum(i, hsum);
+        for(j = 0; j < WIDTH; j++) colsum[j] += hsum[j];
+    }
     for(i = 0; i < HEIGHT; i++) {
+        if(i + RANGE < HEIGHT) {
+            infected_row_sum(i + RANGE, hsum);
+            for(j = 0; j < WIDTH; j++) colsum[j] += hsum[j];
+        }
+        uint8_t* f = &FIELD(i, 0);
         for(j = 0; j < WIDTH; j++) {
-            if(cell[i][j].isPerson) {
-                num++;
+            f[j] = (uint8_t) (colsum[j] > UINT8_MAX ? UINT8_MAX : colsum[j]);
+        }
+        if(i - RANGE >= 0) {
+            infected_row_sum(i - RANGE, hsum);
+            for(j = 0; j < WIDTH; j++) colsum[j] -= hsum[j];
+        }
+    }
+
+    const size_t size = (size_t) HEIGHT * (size_t) WIDTH;
+    for(size_t k = 0; k < size; k++) {
+        state s = cell[k];
+        int count = COUNT(s);
+        if(count > 0) { //だんだん病原菌が抜けていく
+            count--;
+        }
+        if(IS_PERSON(s)) {
+            count += field[k];
+            if(count > COUNT_MAX) count = COUNT_MAX;
+            if(count > THRESHOLD && !IS_INFECTED(s)) {
+                s |= INFECTED_BIT;
+                cell[k] = SET_COUNT(s, count);
+                cluster_add(k); //周りのセルの状態が必要なので、書き込んでから併合する
+                continue;
             }
         }
+        cell[k] = SET_COUNT(s, count);
+    }
+}
+
+long count_total_people() {
+    long num = 0;
+    const size_t size = (size_t) HEIGHT * (size_t) WIDTH;
+    for(size_t k = 0; k < size; k++) {
+        if(IS_PERSON(cell[k])) {
+            num++;
+        }
     }
     return num;
 }
 
-int count_infected_people() {
-    int num = 0;
-    int i, j;
-    for(i = 0; i < HEIGHT; i++) {
-        for(j = 0; j < WIDTH; j++) {
-            if(cell[i][j].isPerson && cell[i][j].isInfected) {
-                num++;
-            }
+long count_infected_people() {
+    long num = 0;
+    const size_t size = (size_t) HEIGHT * (size_t) WIDTH;
+    for(size_t k = 0; k < size; k++) {
+        if(IS_PERSON(cell[k]) && IS_INFECTED(cell[k])) {
+            num++;
         }
     }
     return num;
@@ -190,24 +578,56 @@ int count_infected_people() {
 int main()
 {
     int gen;
-    FILE *fp;
+    FILE *fp, *cfp = NULL;
 
+    if(THRESHOLD >= COUNT_MAX) {
+        fprintf(stderr, "error: THRESHOLD must be less than %d (the pathogen count saturates there).\n", COUNT_MAX);
+        return 1;
+    }
+    if(TRACK_CLUSTERS && MOBILE) {
+        fprintf(stderr, "warning: with MOBILE, clusters are relabelled from scratch every generation.\n");
+    }
     init_cells();
+    cluster_init();
 
     if ((fp = fopen("cells.txt", "w")) == NULL) {
         fprintf(stderr, "error: cannot open a file.\n");
         return 1;
     }
+    if (TRACK_CLUSTERS && (cfp = fopen("clusters.txt", "w")) == NULL) {
+        fprintf(stderr, "error: cannot open a file.\n");
+        return 1;
+    }
 
     print_cells(fp);
+    print_clusters(cfp, 0);
+    render_init();
 
+    //シミュレーションはSIM_RATEで進め、表示はDISPLAY_RATEを超えない範囲で最新の世代を描く
+    double last_display = 0.0;
+    double next_gen = now_sec();
     for (gen = 1;; gen++) {
         update_cells();
-        show_data(gen);
         print_cells(fp);
-        sleep(1);
+        print_clusters(cfp, gen);
+
+        const double now = now_sec();
+        if(now - last_display >= 1.0 / DISPLAY_RATE) {
+            show_data(gen);
+            last_display = now;
+        }
+        if(SIM_RATE > 0) {
+            next_gen += 1.0 / SIM_RATE;
+            const double wait = next_gen - now_sec();
+            if(wait > 0) {
+                usleep((useconds_t) (wait * 1e6));
+            }
+        }
     }
 
+    render_delete();
+    cluster_delete();
     delete_cells();
     fclose(fp);
+    if (cfp != NULL) fclose(cfp);
 }
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asyncout.h"
+
+/* 出力のスレッド **********************************************************/
+static void *writer_main(void *p)
+{
+    out_writer *w = (out_writer *) p;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (w->count == 0 && !w->quit) {
+            pthread_cond_wait(&w->ready, &w->lock);
+        }
+        if (w->count == 0) break; //止めるように言われて、残りもない
+        const int k = w->queue[w->head];
+        w->head = (w->head + 1) % w->nframe;
+        w->count--;
+        pthread_mutex_unlock(&w->lock);
+
+        w->fn(&w->frames[k], w->arg);
+
+        pthread_mutex_lock(&w->lock);
+        w->free_list[w->nfree++] = k;
+        pthread_cond_signal(&w->freed);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/* 開始・終了 **************************************************************/
+void out_start(out_writer *w, int nframe, out_fn fn, void *arg)
+{
+    if (nframe < 1) nframe = 1;
+    w->nframe = nframe;
+    w->frames = (out_frame *) calloc((size_t) nframe, sizeof(out_frame));
+    w->queue = (int *) malloc(sizeof(int) * (size_t) nframe);
+    w->free_list = (int *) malloc(sizeof(int) * (size_t) nframe);
+    if (w->frames == NULL || w->queue == NULL || w->free_list == NULL) {
+        fprintf(stderr, "error: cannot allocate output frames.\n");
+        exit(1);
+    }
+    for (int k = 0; k < nframe; k++) {
+        w->free_list[k] = nframe - 1 - k;
+    }
+    w->nfree = nframe;
+    w->head = w->count = 0;
+    w->quit = 0;
+    w->fn = fn;
+    w->arg = arg;
+    w->nwait = 0;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->ready, NULL);
+    pthread_cond_init(&w->freed, NULL);
+    if (pthread_create(&w->thread, NULL, writer_main, w) != 0) {
+        fprintf(stderr, "error: cannot create output thread.\n");
+        exit(1);
+    }
+}
+
+void out_stop(out_writer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    w->quit = 1;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    for (int k = 0; k < w->nframe; k++) {
+        free(w->frames[k].id);
+        free(w->frames[k].m);
+        free(w->frames[k].r);
+        free(w->frames[k].v);
+    }
+    free(w->frames);
+    free(w->queue);
+    free(w->free_list);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->ready);
+    pthread_cond_destroy(&w->freed);
+}
+
+/* フレームの受け渡し ******************************************************/
+out_frame *out_acquire(out_writer *w, int n)
+{
+    pthread_mutex_lock(&w->lock);
+    if (w->nfree == 0) w->nwait++;
+    while (w->nfree == 0) {
+        pthread_cond_wait(&w->freed, &w->lock);
+    }
+    out_frame *f = &w->frames[w->free_list[--w->nfree]];
+    pthread_mutex_unlock(&w->lock);
+
+    //足りないときだけ確保し直す(星は減る一方なので、普通は最初の1回だけ)
+    if (n > f->cap) {
+        f->id = (int *) realloc(f->id, sizeof(int) * (size_t) n);
+        f->m = (double *) realloc(f->m, sizeof(double) * (size_t) n);
+        f->r = (double (*)[3]) realloc(f->r, sizeof(double) * 3 * (size_t) n);
+        f->v = (double (*)[3]) realloc(f->v, sizeof(double) * 3 * (size_t) n);
+        if (f->id == NULL || f->m == NULL || f->r == NULL || f->v == NULL) {
+            fprintf(stderr, "error: cannot allocate output frames.\n");
+            exit(1);
+        }
+        f->cap = n;
+    }
+    f->n = n;
+    f->has_error = 0;
+    f->has_diag = 0;
+    return f;
+}
+
+void out_submit(out_writer *w, out_frame *f)
+{
+    pthread_mutex_lock(&w->lock);
+    w->queue[(w->head + w->count) % w->nframe] = (int) (f - w->frames);
+    w->count++;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+}
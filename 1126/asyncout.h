@@ -0,0 +1,62 @@
+#ifndef ASYNCOUT_H
+#define ASYNCOUT_H
+
+#include <pthread.h>
+
+#include "diag.h"
+
+/*
+ * 出力を別のスレッドで行う
+ * 計算のスレッドは空いているフレームを受け取って星の状態を写し、出力のスレッドに渡す。
+ * 書式を整えて書き込むのは出力のスレッドなので、計算はその間も止まらない。
+ * フレームは最初に決めた数だけを使い回し、全て使用中のときだけ計算のスレッドが待つ。
+ */
+
+typedef struct {
+    double t;    //時刻
+    long step;   //ステップ数
+    int n;       //星の数
+    int cap;     //確保してある星の数
+    int *id;     //星の元の番号
+    double *m;
+    double (*r)[3];
+    double (*v)[3];
+    int has_error; //力の誤差を測ったら1
+    double error_rms, error_max;
+    int has_diag;    //保存量を測ったら1
+    diag_state diag;
+} out_frame;
+
+/* 出力のスレッドで、渡された順に呼ばれる */
+typedef void (*out_fn)(const out_frame *f, void *arg);
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready; //出力するフレームが来た
+    pthread_cond_t freed; //フレームが空いた
+    out_frame *frames;
+    int nframe;
+    int *queue;   //出力を待つフレームの番号(先に来た順)
+    int head, count;
+    int *free_list;
+    int nfree;
+    int quit;
+    out_fn fn;
+    void *arg;
+    long nwait;   //フレームが空くのを待った回数
+} out_writer;
+
+/* nframe個のフレームを用意して出力のスレッドを始める */
+void out_start(out_writer *w, int nframe, out_fn fn, void *arg);
+
+/* 残っているフレームを全て出力してからスレッドを止める */
+void out_stop(out_writer *w);
+
+/* 空いているフレームを受け取る(全て使用中なら空くまで待つ)。星n個分の大きさにしてある */
+out_frame *out_acquire(out_writer *w, int n);
+
+/* 中身を書いたフレームを出力のスレッドに渡す */
+void out_submit(out_writer *w, out_frame *f);
+
+#endif
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "bhtree.h"
+
+#define MAX_DEPTH 48 //これより深くは分けない(同じ座標の星が重なったとき用)
+#define STACK_SIZE (MAX_DEPTH * 8 + 8)
+
+/* 初期化・解放 ************************************************************/
+void bh_init(bhtree *t)
+{
+    t->node = NULL;
+    t->nnode = 0;
+    t->cap = 0;
+    t->next = NULL;
+    t->nbody = 0;
+    t->leaf_max = 8;
+    t->m = NULL;
+    t->r = NULL;
+}
+
+void bh_free(bhtree *t)
+{
+    const int leaf_max = t->leaf_max;
+    free(t->node);
+    free(t->next);
+    bh_init(t);
+    t->leaf_max = leaf_max;
+}
+
+/* 節点を一つ追加して番号を返す ********************************************/
+static int new_node(bhtree *t, const double center[3], double half)
+{
+    if (t->nnode == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->node = (bh_node *) realloc(t->node, sizeof(bh_node) * (size_t) t->cap);
+        if (t->node == NULL) {
+            fprintf(stderr, "error: cannot allocate tree nodes.\n");
+            exit(1);
+        }
+    }
+    bh_node *nd = &t->node[t->nnode];
+    for (int k = 0; k < 3; k++) {
+        nd->center[k] = center[k];
+        nd->com[k] = 0.0;
+    }
+    nd->half = half;
+    nd->m = 0.0;
+    nd->delta = 0.0;
+    for (int k = 0; k < 8; k++) {
+        nd->child[k] = -1;
+    }
+    nd->leaf = 1;
+    nd->first = -1;
+    nd->count = 0;
+    return t->nnode++;
+}
+
+/* posが節点ndのどの子に入るか */
+static int octant(const bh_node *nd, const double pos[3])
+{
+    return (pos[0] > nd->center[0] ? 1 : 0)
+         | (pos[1] > nd->center[1] ? 2 : 0)
+         | (pos[2] > nd->center[2] ? 4 : 0);
+}
+
+/* 節点ndのoct番目の子を(なければ作って)返す */
+static int child_of(bhtree *t, int nd, int oct)
+{
+    if (t->node[nd].child[oct] < 0) {
+        const double h = t->node[nd].half / 2;
+        double c[3];
+        for (int k = 0; k < 3; k++) {
+            c[k] = t->node[nd].center[k] + ((oct >> k) & 1 ? h : -h);
+        }
+        const int ch = new_node(t, c, h); //reallocで t->node が動くので先に作る
+        t->node[nd].child[oct] = ch;
+    }
+    return t->node[nd].child[oct];
+}
+
+/* 葉ndに星iを入れる */
+static void push_leaf(bhtree *t, int nd, int i)
+{
+    t->next[i] = t->node[nd].first;
+    t->node[nd].first = i;
+    t->node[nd].count++;
+}
+
+/* 星iを木に入れる *********************************************************/
+static void insert(bhtree *t, int i)
+{
+    int nd = 0;
+    for (int depth = 0;; depth++) {
+        if (t->node[nd].leaf) {
+            if (t->node[nd].count < t->leaf_max || depth >= MAX_DEPTH) {
+                push_leaf(t, nd, i);
+                return;
+            }
+            //葉があふれたので分割して、中の星を子に移す
+            int j = t->node[nd].first;
+            t->node[nd].leaf = 0;
+            t->node[nd].first = -1;
+            while (j >= 0) {
+                const int jn = t->next[j];
+                push_leaf(t, child_of(t, nd, octant(&t->node[nd], t->r[j])), j);
+                j = jn;
+            }
+        }
+        t->node[nd].count++;
+        nd = child_of(t, nd, octant(&t->node[nd], t->r[i]));
+    }
+}
+
+/* 木の構築 ****************************************************************/
+void bh_build(bhtree *t, int n, const double *m, const double (*r)[3])
+{
+    int i, k;
+
+    t->m = m;
+    t->r = r;
+    t->nnode = 0;
+    if (n > t->nbody) {
+        t->next = (int *) realloc(t->next, sizeof(int) * (size_t) n);
+        if (t->next == NULL) {
+            fprintf(stderr, "error: cannot allocate tree.\n");
+            exit(1);
+        }
+    }
+    t->nbody = n;
+
+    //全ての星を含む立方体
+    double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+    double hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    int nactive = 0;
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        nactive++;
+        for (k = 0; k < 3; k++) {
+            if (r[i][k] < lo[k]) lo[k] = r[i][k];
+            if (r[i][k] > hi[k]) hi[k] = r[i][k];
+        }
+    }
+    if (nactive == 0) return;
+
+    double center[3], half = 0.0;
+    for (k = 0; k < 3; k++) {
+        center[k] = (lo[k] + hi[k]) / 2;
+        if ((hi[k] - lo[k]) / 2 > half) half = (hi[k] - lo[k]) / 2;
+    }
+    half = half * 1.0001 + 1e-12; //端の星がはみ出さないように少し広げる
+
+    new_node(t, center, half);
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        insert(t, i);
+    }
+
+    //子は親より後ろに作られるので、後ろから順に質量と重心を集める
+    for (int nd = t->nnode - 1; nd >= 0; nd--) {
+        bh_node *p = &t->node[nd];
+        double mass = 0.0, com[3] = {0.0, 0.0, 0.0};
+        if (p->leaf) {
+            for (i = p->first; i >= 0; i = t->next[i]) {
+                mass += m[i];
+                for (k = 0; k < 3; k++) com[k] += m[i] * r[i][k];
+            }
+        } else {
+            for (int c = 0; c < 8; c++) {
+                if (p->child[c] < 0) continue;
+                const bh_node *ch = &t->node[p->child[c]];
+                mass += ch->m;
+                for (k = 0; k < 3; k++) com[k] += ch->m * ch->com[k];
+            }
+        }
+        p->m = mass;
+        double d2 = 0.0;
+        for (k = 0; k < 3; k++) {
+            p->com[k] = mass > 0 ? com[k] / mass : p->center[k];
+            d2 += (p->com[k] - p->center[k]) * (p->com[k] - p->center[k]);
+        }
+        p->delta = sqrt(d2);
+    }
+}
+
+/* 木をたどって加速度を求める **********************************************/
+long bh_accel(const bhtree *t, const double pos[3], int self,
+              double theta, double eps, double a[3])
+{
+    int stack[STACK_SIZE];
+    int sp = 0;
+    long ninteract = 0;
+    const double eps2 = eps * eps;
+    double ax = 0.0, ay = 0.0, az = 0.0;
+
+    a[0] = a[1] = a[2] = 0.0;
+    if (t->nnode == 0) return 0;
+
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const bh_node *nd = &t->node[stack[--sp]];
+        const double dx = nd->com[0] - pos[0];
+        const double dy = nd->com[1] - pos[1];
+        const double dz = nd->com[2] - pos[2];
+        const double d2 = dx * dx + dy * dy + dz * dz;
+
+        //開く判定: d > s / theta + delta なら節点全体を一つの質点とみなす
+        //(deltaを足しておくと、重心が偏った節点の中に自分がいても誤って受け入れない)
+        const double open = theta > 0 ? 2 * nd->half / theta + nd->delta : HUGE_VAL;
+        if (d2 > open * open) {
+            const double r2 = d2 + eps2;
+            const double inv = nd->m / (r2 * sqrt(r2));
+            ax += dx * inv;
+            ay += dy * inv;
+            az += dz * inv;
+            ninteract++;
+        } else if (nd->leaf) {
+            for (int j = nd->first; j >= 0; j = t->next[j]) {
+                if (j == self) continue;
+                const double ex = t->r[j][0] - pos[0];
+                const double ey = t->r[j][1] - pos[1];
+                const double ez = t->r[j][2] - pos[2];
+                const double r2 = ex * ex + ey * ey + ez * ez + eps2;
+                if (r2 == 0) continue; //ソフトニングなしで重なった星は、直接計算と同じく足さない
+                const double inv = t->m[j] / (r2 * sqrt(r2));
+                ax += ex * inv;
+                ay += ey * inv;
+                az += ez * inv;
+                ninteract++;
+            }
+        } else {
+            for (int c = 0; c < 8; c++) {
+                if (nd->child[c] >= 0) stack[sp++] = nd->child[c];
+            }
+        }
+    }
+
+    a[0] = ax;
+    a[1] = ay;
+    a[2] = az;
+    return ninteract;
+}
+
+/* 木をたどってポテンシャルを求める ****************************************/
+double bh_potential(const bhtree *t, const double pos[3], int self, double theta, double eps)
+{
+    int stack[STACK_SIZE];
+    int sp = 0;
+    const double eps2 = eps * eps;
+    double phi = 0.0;
+
+    if (t->nnode == 0) return 0.0;
+
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const bh_node *nd = &t->node[stack[--sp]];
+        const double dx = nd->com[0] - pos[0];
+        const double dy = nd->com[1] - pos[1];
+        const double dz = nd->com[2] - pos[2];
+        const double d2 = dx * dx + dy * dy + dz * dz;
+
+        const double open = theta > 0 ? 2 * nd->half / theta + nd->delta : HUGE_VAL;
+        if (d2 > open * open) {
+            phi -= nd->m / sqrt(d2 + eps2);
+        } else if (nd->leaf) {
+            for (int j = nd->first; j >= 0; j = t->next[j]) {
+                if (j == self) continue;
+                const double ex = t->r[j][0] - pos[0];
+                const double ey = t->r[j][1] - pos[1];
+                const double ez = t->r[j][2] - pos[2];
+                const double r2 = ex * ex + ey * ey + ez * ez + eps2;
+                if (r2 == 0) continue;
+                phi -= t->m[j] / sqrt(r2);
+            }
+        } else {
+            for (int c = 0; c < 8; c++) {
+                if (nd->child[c] >= 0) stack[sp++] = nd->child[c];
+            }
+        }
+    }
+    return phi;
+}
@@ -0,0 +1,51 @@
+#ifndef BHTREE_H
+#define BHTREE_H
+
+/*
+ * Barnes-Hut法のための八分木
+ * 毎ステップ作り直す。節点の配列は使い回すので、二回目以降はほとんど確保しない。
+ */
+
+typedef struct {
+    double center[3]; //立方体の中心
+    double half;      //立方体の一辺の半分
+    double m;         //含まれる質量
+    double com[3];    //重心
+    double delta;     //重心と中心の距離(開く判定に使う)
+    int child[8];     //子の節点番号(なければ-1)
+    int leaf;         //葉なら1
+    int first;        //葉に含まれる最初の星(next[]でつながる)
+    int count;        //含まれる星の数
+} bh_node;
+
+typedef struct {
+    bh_node *node;
+    int nnode, cap;
+    int *next; //葉の中の星のリスト
+    int nbody;
+    int leaf_max; //葉に入れる星の数の上限(bh_initでは8)
+    const double *m;
+    const double (*r)[3];
+} bhtree;
+
+void bh_init(bhtree *t);
+void bh_free(bhtree *t);
+
+/* 質量が0でない星から木を作る。m, rは木を使い終わるまで書き換えないこと */
+void bh_build(bhtree *t, int n, const double *m, const double (*r)[3]);
+
+/*
+ * 座標posにおける加速度(G = 1)をaに書き込む。
+ * selfは自分自身の星の番号(なければ-1)で、その星からの寄与は除く。距離が0になる星(eps = 0で重なった星)も足さない。
+ * 戻り値は計算した相互作用の数。
+ */
+long bh_accel(const bhtree *t, const double pos[3], int self,
+              double theta, double eps, double a[3]);
+
+/*
+ * 座標posにおける重力ポテンシャル(G = 1, -Σ m / r)を返す。
+ * selfとtheta, epsの意味はbh_accelと同じ。
+ */
+double bh_potential(const bhtree *t, const double pos[3], int self, double theta, double eps);
+
+#endif
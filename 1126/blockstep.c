@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "blockstep.h"
+
+#define BLOCK_MAX_LEVEL 30 //時刻をlongで数えるための上限
+
+/* 初期化・解放 ************************************************************/
+void block_init(blockstep *b, double dt_max, int max_level, double eta)
+{
+    if (max_level < 0) max_level = 0;
+    if (max_level > BLOCK_MAX_LEVEL) max_level = BLOCK_MAX_LEVEL;
+    b->n = 0;
+    b->cap = 0;
+    b->dt_max = dt_max;
+    b->max_level = max_level;
+    b->eta = eta;
+    b->ready = 0;
+    b->level = NULL;
+    b->t_end = NULL;
+    b->a = b->a_prev = NULL;
+    b->active = NULL;
+    b->nforce = b->nsub = b->nshared = 0;
+}
+
+void block_free(blockstep *b)
+{
+    free(b->level);
+    free(b->t_end);
+    free(b->a);
+    free(b->a_prev);
+    free(b->active);
+    block_init(b, b->dt_max, b->max_level, b->eta);
+}
+
+void block_reset(blockstep *b)
+{
+    b->ready = 0;
+}
+
+static void block_resize(blockstep *b, int n)
+{
+    if (n > b->cap) {
+        b->level = (int *) realloc(b->level, sizeof(int) * (size_t) n);
+        b->t_end = (long *) realloc(b->t_end, sizeof(long) * (size_t) n);
+        b->a = (double (*)[3]) realloc(b->a, sizeof(double) * 3 * (size_t) n);
+        b->a_prev = (double (*)[3]) realloc(b->a_prev, sizeof(double) * 3 * (size_t) n);
+        b->active = (int *) realloc(b->active, sizeof(int) * (size_t) n);
+        if (b->level == NULL || b->t_end == NULL || b->a == NULL ||
+            b->a_prev == NULL || b->active == NULL) {
+            fprintf(stderr, "error: cannot allocate block timesteps.\n");
+            exit(1);
+        }
+        b->cap = n;
+    }
+    if (n != b->n) b->ready = 0;
+    b->n = n;
+}
+
+/*
+ * 刻みの段を選ぶ ***********************************************************
+ * 時刻tで刻みを始められる段の中から、eta * |a| / |j| を超えない一番長い刻みを選ぶ。
+ * 刻みの始まりは刻みの長さの倍数でなければならないので、そろわなければ短くする。
+ */
+static int choose_level(const blockstep *b, const double a[3], const double a_prev[3],
+                        double dt_old, long t)
+{
+    const long T = 1L << b->max_level;
+    double a2 = 0.0, j2 = 0.0;
+    for (int k = 0; k < 3; k++) {
+        const double j = (a[k] - a_prev[k]) / dt_old;
+        a2 += a[k] * a[k];
+        j2 += j * j;
+    }
+
+    int level = 0;
+    if (j2 > 0) {
+        const double dt = b->eta * sqrt(a2 / j2);
+        while (level < b->max_level && b->dt_max / (double) (1L << level) > dt) {
+            level++;
+        }
+    }
+    while (t % (T >> level) != 0) {
+        level++;
+    }
+    return level;
+}
+
+/* 1ブロック進める *********************************************************/
+void block_step(blockstep *b, const force_param *p, int n, const double *m,
+                double (*r)[3], double (*v)[3])
+{
+    const long T = 1L << b->max_level;
+    const double tick = b->dt_max / (double) T;
+    int i, k;
+
+    block_resize(b, n);
+
+    //最初は全ての星の加速度を求め、一番短い刻みから始める(加加速度がまだわからないため)
+    if (!b->ready) {
+        force_accel(p, n, m, (const double (*)[3]) r, b->a);
+        for (i = 0; i < n; i++) {
+            b->level[i] = b->max_level;
+        }
+        b->nforce += n;
+        b->nsub++;
+        b->ready = 1;
+    }
+
+    //ブロックの始まりでは全ての星がそろっているので、全ての星の前半のキックを行う
+    int nalive = 0, deepest = 0;
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) {
+            b->t_end[i] = T + 1; //動かさない
+            continue;
+        }
+        nalive++;
+        const long s = T >> b->level[i];
+        b->t_end[i] = s;
+        if (b->level[i] > deepest) deepest = b->level[i];
+        for (k = 0; k < 3; k++) {
+            v[i][k] += b->a[i][k] * (0.5 * (double) s * tick);
+        }
+    }
+
+    long t = 0;
+    while (t < T) {
+        //次に刻みが終わる時刻までドリフトする
+        long next = T;
+        for (i = 0; i < n; i++) {
+            if (b->t_end[i] < next) next = b->t_end[i];
+        }
+        const double h = (double) (next - t) * tick;
+        for (i = 0; i < n; i++) {
+            if (m[i] == 0) continue;
+            for (k = 0; k < 3; k++) {
+                r[i][k] += v[i][k] * h;
+            }
+        }
+        t = next;
+
+        //刻みが終わった星だけ加速度を求め直す
+        int nactive = 0;
+        for (i = 0; i < n; i++) {
+            if (b->t_end[i] == t) {
+                b->active[nactive++] = i;
+                for (k = 0; k < 3; k++) {
+                    b->a_prev[i][k] = b->a[i][k];
+                }
+            }
+        }
+        force_accel_active(p, n, m, (const double (*)[3]) r, nactive, b->active, b->a);
+        b->nforce += nactive;
+        b->nsub++;
+
+        //後半のキックをしてから次の刻みを選び、ブロックの途中なら次の前半のキックを行う
+        for (int q = 0; q < nactive; q++) {
+            i = b->active[q];
+            const double dt_old = (double) (T >> b->level[i]) * tick;
+            for (k = 0; k < 3; k++) {
+                v[i][k] += b->a[i][k] * (0.5 * dt_old);
+            }
+            b->level[i] = choose_level(b, b->a[i], b->a_prev[i], dt_old, t);
+            if (t == T) continue;
+            if (b->level[i] > deepest) deepest = b->level[i];
+            const long s = T >> b->level[i];
+            b->t_end[i] = t + s;
+            for (k = 0; k < 3; k++) {
+                v[i][k] += b->a[i][k] * (0.5 * (double) s * tick);
+            }
+        }
+    }
+    b->nshared += (long) nalive << deepest;
+}
+
+/* チェックポイント ********************************************************/
+typedef struct {
+    double dt_max;
+    double eta;
+    int max_level;
+    int n;
+    int ready;
+    long nforce, nsub, nshared;
+} block_header;
+
+void block_save(const blockstep *b, ckpt_writer *w)
+{
+    block_header h;
+    const size_t n = (size_t) (b->ready ? b->n : 0);
+
+    memset(&h, 0, sizeof(h));
+    h.dt_max = b->dt_max;
+    h.eta = b->eta;
+    h.max_level = b->max_level;
+    h.n = b->n;
+    h.ready = b->ready;
+    h.nforce = b->nforce;
+    h.nsub = b->nsub;
+    h.nshared = b->nshared;
+    ckpt_put(w, "block", &h, sizeof(h));
+    ckpt_put(w, "block.level", b->level, sizeof(int) * n);
+    ckpt_put(w, "block.a", b->a, sizeof(double) * 3 * n);
+}
+
+int block_restore(blockstep *b, const ckpt_reader *rd)
+{
+    block_header h;
+
+    if (ckpt_read(rd, "block", &h, sizeof(h)) != 0 || h.dt_max != b->dt_max ||
+        h.eta != b->eta || h.max_level != b->max_level) {
+        return -1;
+    }
+    block_resize(b, h.n);
+    const size_t n = (size_t) (h.ready ? h.n : 0);
+    if (ckpt_read(rd, "block.level", b->level, sizeof(int) * n) != 0 ||
+        ckpt_read(rd, "block.a", b->a, sizeof(double) * 3 * n) != 0) {
+        return -1;
+    }
+    b->ready = h.ready;
+    b->nforce = h.nforce;
+    b->nsub = h.nsub;
+    b->nshared = h.nshared;
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef BLOCKSTEP_H
+#define BLOCKSTEP_H
+
+#include "force.h"
+#include "checkpoint.h"
+
+/*
+ * 階層的ブロック時間刻み
+ * 星ごとに刻みを dt_max / 2^level (levelは0からmax_level)の中から選び、
+ * 刻みの終わりに来た星(活動中の星)だけの加速度を計算し直す。
+ * 刻みは加速度aと加加速度jから dt = eta * |a| / |j| で決める。
+ * jは同じ星の前回の加速度との差から見積もる。
+ * 各星は蛙跳び法(キック・ドリフト・キック)で進め、ドリフトは全ての星で行う。
+ * block_stepを呼ぶごとにdt_maxだけ進み、終わったときは全ての星の時刻と速度がそろう。
+ */
+
+typedef struct {
+    int n;          //星の数
+    int cap;
+    double dt_max;  //一番長い刻み(ブロックの長さ)
+    int max_level;  //一番短い刻みは dt_max / 2^max_level
+    double eta;     //刻みの精度パラメータ(小さいほど正確で遅い)
+    int ready;      //加速度と刻みが求めてあれば1
+    int *level;     //星ごとの刻みの段
+    long *t_end;    //今の刻みが終わる時刻(ブロックの中での最短刻み単位)
+    double (*a)[3]; //最後に求めた加速度
+    double (*a_prev)[3];
+    int *active;
+    long nforce;    //加速度を求めた星の延べ数
+    long nsub;      //加速度を計算した回数
+    long nshared;   //全ての星を最短の刻みで進めたときに必要な星の延べ数
+} blockstep;
+
+void block_init(blockstep *b, double dt_max, int max_level, double eta);
+void block_free(blockstep *b);
+
+/* 星が融合したときなど、次のステップで全ての星の加速度と刻みを求め直させる */
+void block_reset(blockstep *b);
+
+/*
+ * ブロックをまたいで持ち越す状態(星ごとの段と最後の加速度)をチェックポイントに書く・読む。
+ * 読むときは同じdt_max, max_level, etaでblock_initしておくこと。合わなければ-1
+ */
+void block_save(const blockstep *b, ckpt_writer *w);
+int block_restore(blockstep *b, const ckpt_reader *rd);
+
+/* n個の星の座標rと速度vをdt_maxだけ進める。質量0の星は動かさない。 */
+void block_step(blockstep *b, const force_param *p, int n, const double *m,
+                double (*r)[3], double (*v)[3]);
+
+#endif
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bodies.h"
+
+#define BODIES_ALIGN 64
+
+/* 初期化・解放 ************************************************************/
+void bodies_init(bodies *b)
+{
+    b->n = 0;
+    b->cap = 0;
+    b->x = b->y = b->z = NULL;
+    b->vx = b->vy = b->vz = NULL;
+    b->m = NULL;
+}
+
+void bodies_free(bodies *b)
+{
+    free(b->x);
+    free(b->y);
+    free(b->z);
+    free(b->vx);
+    free(b->vy);
+    free(b->vz);
+    free(b->m);
+    bodies_init(b);
+}
+
+int bodies_padded(int n)
+{
+    return (n + BODIES_PAD - 1) / BODIES_PAD * BODIES_PAD;
+}
+
+/* そろえた配列を確保し、古い内容をコピーする */
+static double *realloc_aligned(double *old, int n_old, int cap)
+{
+    void *p;
+    if (posix_memalign(&p, BODIES_ALIGN, sizeof(double) * (size_t) cap) != 0) {
+        fprintf(stderr, "error: cannot allocate bodies.\n");
+        exit(1);
+    }
+    double *d = (double *) p;
+    if (old != NULL) {
+        memcpy(d, old, sizeof(double) * (size_t) n_old);
+    }
+    memset(d + n_old, 0, sizeof(double) * (size_t) (cap - n_old));
+    free(old);
+    return d;
+}
+
+/* 星の数を変える **********************************************************/
+void bodies_resize(bodies *b, int n)
+{
+    const int padded = bodies_padded(n);
+    if (padded > b->cap) {
+        int cap = b->cap ? b->cap : BODIES_PAD;
+        while (cap < padded) cap *= 2;
+        const int keep = b->n;
+        b->x = realloc_aligned(b->x, keep, cap);
+        b->y = realloc_aligned(b->y, keep, cap);
+        b->z = realloc_aligned(b->z, keep, cap);
+        b->vx = realloc_aligned(b->vx, keep, cap);
+        b->vy = realloc_aligned(b->vy, keep, cap);
+        b->vz = realloc_aligned(b->vz, keep, cap);
+        b->m = realloc_aligned(b->m, keep, cap);
+        b->cap = cap;
+    }
+    //減らしたときは、はみ出した部分を質量0に戻す
+    for (int i = n; i < b->n && i < b->cap; i++) {
+        b->x[i] = b->y[i] = b->z[i] = 0.0;
+        b->vx[i] = b->vy[i] = b->vz[i] = 0.0;
+        b->m[i] = 0.0;
+    }
+    b->n = n;
+}
+
+/* floatの版 ***************************************************************/
+void bodies_f_init(bodies_f *f)
+{
+    f->n = 0;
+    f->cap = 0;
+    f->x = f->y = f->z = f->m = NULL;
+}
+
+void bodies_f_free(bodies_f *f)
+{
+    free(f->x);
+    free(f->y);
+    free(f->z);
+    free(f->m);
+    bodies_f_init(f);
+}
+
+int bodies_f_padded(int n)
+{
+    return (n + BODIES_F_PAD - 1) / BODIES_F_PAD * BODIES_F_PAD;
+}
+
+static float *alloc_aligned_f(float *old, int cap)
+{
+    void *p;
+    free(old);
+    if (posix_memalign(&p, BODIES_ALIGN, sizeof(float) * (size_t) cap) != 0) {
+        fprintf(stderr, "error: cannot allocate bodies.\n");
+        exit(1);
+    }
+    return (float *) p;
+}
+
+void bodies_f_from(bodies_f *f, const bodies *b, const double origin[3])
+{
+    const int padded = bodies_f_padded(b->n);
+    if (padded > f->cap) {
+        int cap = f->cap ? f->cap : BODIES_F_PAD;
+        while (cap < padded) cap *= 2;
+        f->x = alloc_aligned_f(f->x, cap);
+        f->y = alloc_aligned_f(f->y, cap);
+        f->z = alloc_aligned_f(f->z, cap);
+        f->m = alloc_aligned_f(f->m, cap);
+        f->cap = cap;
+    }
+    for (int i = 0; i < b->n; i++) {
+        f->x[i] = (float) (b->x[i] - origin[0]);
+        f->y[i] = (float) (b->y[i] - origin[1]);
+        f->z[i] = (float) (b->z[i] - origin[2]);
+        f->m[i] = (float) b->m[i];
+    }
+    for (int i = b->n; i < padded; i++) {
+        f->x[i] = f->y[i] = f->z[i] = 0.0f;
+        f->m[i] = 0.0f;
+    }
+    f->n = b->n;
+}
@@ -0,0 +1,53 @@
+#ifndef BODIES_H
+#define BODIES_H
+
+/*
+ * 星の情報を成分ごとの配列(structure of arrays)で持つ。
+ * 各配列は64バイト境界にそろえ、長さをBODIES_PADの倍数に切り上げてある。
+ * 余った部分は質量0の星として扱うので、SIMDで端数を気にせずに読める。
+ */
+
+#define BODIES_PAD 8 //AVX-512で一度に扱うdoubleの数
+
+typedef struct {
+    int n;   //星の数
+    int cap; //確保してある長さ(BODIES_PADの倍数)
+    double *x, *y, *z;
+    double *vx, *vy, *vz;
+    double *m;
+} bodies;
+
+void bodies_init(bodies *b);
+void bodies_free(bodies *b);
+
+/* 星の数をnにする。増えた分と端数の部分は0で埋める */
+void bodies_resize(bodies *b, int n);
+
+/* nをBODIES_PADの倍数に切り上げる */
+int bodies_padded(int n);
+
+/*
+ * 混合精度の直接計算に使う、座標と質量だけをfloatで持つ版
+ * 座標は原点originからの差にしてから丸める(原点から遠い星どうしでも差の精度を保つため)。
+ * 長さはBODIES_F_PAD (AVX-512で一度に扱うfloatの数)の倍数に切り上げ、余りは質量0にする。
+ */
+
+#define BODIES_F_PAD 16
+
+typedef struct {
+    int n;
+    int cap;
+    float *x, *y, *z;
+    float *m;
+} bodies_f;
+
+void bodies_f_init(bodies_f *f);
+void bodies_f_free(bodies_f *f);
+
+/* nをBODIES_F_PADの倍数に切り上げる */
+int bodies_f_padded(int n);
+
+/* bの座標からoriginを引いてfloatにしたものをfに入れる */
+void bodies_f_from(bodies_f *f, const bodies *b, const double origin[3]);
+
+#endif
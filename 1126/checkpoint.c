@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+/* 書き込み ****************************************************************/
+int ckpt_begin(ckpt_writer *w, const char *path)
+{
+    const size_t len = strlen(path);
+
+    w->fp = NULL;
+    w->error = 0;
+    w->path = (char *) malloc(len + 1);
+    w->tmp = (char *) malloc(len + 5);
+    if (w->path == NULL || w->tmp == NULL) {
+        fprintf(stderr, "error: cannot allocate checkpoint path.\n");
+        free(w->path);
+        free(w->tmp);
+        return -1;
+    }
+    memcpy(w->path, path, len + 1);
+    memcpy(w->tmp, path, len);
+    memcpy(w->tmp + len, ".tmp", 5);
+
+    if ((w->fp = fopen(w->tmp, "wb")) == NULL) {
+        fprintf(stderr, "error: cannot open %s.\n", w->tmp);
+        free(w->path);
+        free(w->tmp);
+        return -1;
+    }
+    setvbuf(w->fp, NULL, _IOFBF, 1 << 22);
+    if (fwrite(CKPT_MAGIC, 8, 1, w->fp) != 1) w->error = 1;
+    return 0;
+}
+
+void ckpt_put(ckpt_writer *w, const char *name, const void *data, size_t size)
+{
+    static const char zero[8] = {0};
+    ckpt_section s;
+
+    memset(&s, 0, sizeof(s));
+    strncpy(s.name, name, CKPT_NAME - 1);
+    s.size = (unsigned long long) size;
+    if (fwrite(&s, sizeof(s), 1, w->fp) != 1) w->error = 1;
+    if (size > 0 && fwrite(data, 1, size, w->fp) != size) w->error = 1;
+    if (size % 8 != 0 && fwrite(zero, 1, 8 - size % 8, w->fp) != 8 - size % 8) w->error = 1;
+}
+
+int ckpt_commit(ckpt_writer *w)
+{
+    ckpt_put(w, "end", NULL, 0);
+    if (fflush(w->fp) != 0 || fsync(fileno(w->fp)) != 0) w->error = 1;
+    if (fclose(w->fp) != 0) w->error = 1;
+    if (!w->error && rename(w->tmp, w->path) != 0) w->error = 1;
+    if (w->error) {
+        fprintf(stderr, "error: cannot write checkpoint %s.\n", w->path);
+        remove(w->tmp);
+    }
+    free(w->path);
+    free(w->tmp);
+    w->fp = NULL;
+    w->path = w->tmp = NULL;
+    return w->error ? -1 : 0;
+}
+
+/* 読み込み ****************************************************************/
+int ckpt_open(ckpt_reader *rd, const char *path)
+{
+    struct stat st;
+
+    rd->data = NULL;
+    if ((rd->fd = open(path, O_RDONLY)) < 0) {
+        fprintf(stderr, "error: cannot open %s.\n", path);
+        return -1;
+    }
+    if (fstat(rd->fd, &st) != 0 || (size_t) st.st_size < 8 + sizeof(ckpt_section)) {
+        fprintf(stderr, "error: %s is not a checkpoint file.\n", path);
+        close(rd->fd);
+        return -1;
+    }
+    rd->size = (size_t) st.st_size;
+    void *p = mmap(NULL, rd->size, PROT_READ, MAP_SHARED, rd->fd, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "error: cannot map %s.\n", path);
+        close(rd->fd);
+        return -1;
+    }
+    rd->data = (const char *) p;
+    if (memcmp(rd->data, CKPT_MAGIC, 8) != 0 || ckpt_get(rd, "end", NULL) == NULL) {
+        fprintf(stderr, "error: %s is not a complete checkpoint file.\n", path);
+        ckpt_close(rd);
+        return -1;
+    }
+    return 0;
+}
+
+void ckpt_close(ckpt_reader *rd)
+{
+    if (rd->data != NULL) munmap((void *) rd->data, rd->size);
+    close(rd->fd);
+    rd->data = NULL;
+}
+
+const void *ckpt_get(const ckpt_reader *rd, const char *name, size_t *size)
+{
+    size_t offset = 8;
+
+    while (offset + sizeof(ckpt_section) <= rd->size) {
+        ckpt_section s;
+        memcpy(&s, rd->data + offset, sizeof(s));
+        offset += sizeof(s);
+        if (s.size > rd->size - offset) break; //途中で切れている
+        if (strncmp(s.name, name, CKPT_NAME) == 0) {
+            if (size != NULL) *size = (size_t) s.size;
+            return rd->data + offset;
+        }
+        offset += (size_t) ((s.size + 7) / 8 * 8);
+    }
+    return NULL;
+}
+
+int ckpt_read(const ckpt_reader *rd, const char *name, void *dst, size_t size)
+{
+    size_t got;
+    const void *p = ckpt_get(rd, name, &got);
+
+    if (p == NULL || got != size) return -1;
+    memcpy(dst, p, size);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * 計算を途中から再開するためのチェックポイント
+ * 名前の付いたかたまり(セクション)を並べたバイナリファイルで、
+ *   先頭に CKPT_MAGIC (8バイト)
+ *   セクションごとに ckpt_section と size バイトの中身(8バイト境界まで0で埋める)
+ *   最後に名前が "end" で大きさ0のセクション
+ * を書く。書くときは path.tmp に書いてfsyncしてからpathに名前を変えるので、
+ * 途中で止まっても前のチェックポイントが壊れない。
+ * 数はすべてこの計算機のバイト順で書く。
+ */
+
+#define CKPT_MAGIC "NBCKPT01"
+#define CKPT_NAME 16
+
+typedef struct {
+    char name[CKPT_NAME];    //セクションの名前('\0'で終わる)
+    unsigned long long size; //中身の大きさ
+} ckpt_section;
+
+/* 書き込み ****************************************************************/
+typedef struct {
+    FILE *fp;
+    char *path; //最後に置く名前
+    char *tmp;  //書いている途中の名前
+    int error;  //書けなかったら1
+} ckpt_writer;
+
+/* path.tmpを開いて書き始める。失敗したら-1 */
+int ckpt_begin(ckpt_writer *w, const char *path);
+
+/* セクションを1つ書く(nameは15文字まで) */
+void ckpt_put(ckpt_writer *w, const char *name, const void *data, size_t size);
+
+/* 書き終えてpathに置き換える。失敗したら一時ファイルを消して-1 */
+int ckpt_commit(ckpt_writer *w);
+
+/* 読み込み ****************************************************************/
+typedef struct {
+    const char *data; //写像したファイル
+    size_t size;
+    int fd;
+} ckpt_reader;
+
+/* pathを読み込み用に写像する。失敗したらメッセージを表示して-1 */
+int ckpt_open(ckpt_reader *rd, const char *path);
+void ckpt_close(ckpt_reader *rd);
+
+/* 名前がnameのセクションの中身を返す(写像した領域を直接指す)。なければNULL */
+const void *ckpt_get(const ckpt_reader *rd, const char *name, size_t *size);
+
+/* 名前がnameで大きさがsizeのセクションをdstに写す。なければ, 大きさが違えば-1 */
+int ckpt_read(const ckpt_reader *rd, const char *name, void *dst, size_t size);
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "collide.h"
+
+/* 初期化・解放 ************************************************************/
+void collide_init(collider *c)
+{
+    c->cap = 0;
+    c->table_size = 0;
+    c->parent = NULL;
+    c->key = NULL;
+    c->start = NULL;
+    c->order = NULL;
+    c->sum = NULL;
+    c->size = NULL;
+}
+
+void collide_free(collider *c)
+{
+    free(c->parent);
+    free(c->key);
+    free(c->start);
+    free(c->order);
+    free(c->sum);
+    free(c->size);
+    collide_init(c);
+}
+
+static void collide_resize(collider *c, int n)
+{
+    if (n <= c->cap) return;
+    int size = 16;
+    while (size < 2 * n) size *= 2;
+    c->parent = (int *) realloc(c->parent, sizeof(int) * (size_t) n);
+    c->key = (unsigned *) realloc(c->key, sizeof(unsigned) * (size_t) n);
+    c->order = (int *) realloc(c->order, sizeof(int) * (size_t) n);
+    c->sum = (double (*)[6]) realloc(c->sum, sizeof(double) * 6 * (size_t) n);
+    c->size = (int *) realloc(c->size, sizeof(int) * (size_t) n);
+    c->start = (int *) realloc(c->start, sizeof(int) * (size_t) (size + 1));
+    if (c->parent == NULL || c->key == NULL || c->order == NULL ||
+        c->sum == NULL || c->size == NULL || c->start == NULL) {
+        fprintf(stderr, "error: cannot allocate collision table.\n");
+        exit(1);
+    }
+    c->cap = n;
+    c->table_size = size;
+}
+
+/* セルの番号のハッシュ ****************************************************/
+static unsigned cell_hash(long long cx, long long cy, long long cz, int table_size)
+{
+    unsigned long long h = (unsigned long long) cx * 0x9E3779B97F4A7C15ULL;
+    h ^= (unsigned long long) cy * 0xC2B2AE3D27D4EB4FULL;
+    h ^= (unsigned long long) cz * 0x165667B19E3779F9ULL;
+    h ^= h >> 29;
+    return (unsigned) h & (unsigned) (table_size - 1);
+}
+
+/* Union-Find **************************************************************/
+static int find(int *parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/* 番号の小さい方を根にする */
+static void unite(int *parent, int i, int j)
+{
+    i = find(parent, i);
+    j = find(parent, j);
+    if (i < j) {
+        parent[j] = i;
+    } else if (j < i) {
+        parent[i] = j;
+    }
+}
+
+/* 融合 ********************************************************************/
+int collide_merge(collider *c, int n, double *m, double (*r)[3], double (*v)[3], double R)
+{
+    int i, k;
+
+    if (n == 0 || !(R > 0)) return 0;
+    collide_resize(c, n);
+    const int size = c->table_size;
+
+    //星をセルのハッシュごとに数え、並べ直す(質量0の星は入れない)
+    for (i = 0; i <= size; i++) {
+        c->start[i] = 0;
+    }
+    for (i = 0; i < n; i++) {
+        c->parent[i] = i;
+        if (m[i] == 0) continue;
+        c->key[i] = cell_hash((long long) floor(r[i][0] / R), (long long) floor(r[i][1] / R),
+                              (long long) floor(r[i][2] / R), size);
+        c->start[c->key[i] + 1]++;
+    }
+    for (i = 0; i < size; i++) {
+        c->start[i + 1] += c->start[i];
+    }
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        c->order[c->start[c->key[i]]++] = i;
+    }
+    for (i = size; i > 0; i--) { //ずらした分を戻す
+        c->start[i] = c->start[i - 1];
+    }
+    c->start[0] = 0;
+
+    //隣り合うセルの星とだけ距離を比べる
+    int found = 0;
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        const long long cx = (long long) floor(r[i][0] / R);
+        const long long cy = (long long) floor(r[i][1] / R);
+        const long long cz = (long long) floor(r[i][2] / R);
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    const unsigned h = cell_hash(cx + dx, cy + dy, cz + dz, size);
+                    for (int q = c->start[h]; q < c->start[h + 1]; q++) {
+                        const int j = c->order[q];
+                        if (j <= i) continue; //組は一度だけ調べる
+                        double d2 = 0.0;
+                        for (k = 0; k < 3; k++) {
+                            const double d = r[i][k] - r[j][k];
+                            d2 += d * d;
+                        }
+                        if (d2 < R * R) {
+                            unite(c->parent, i, j);
+                            found = 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (!found) return 0;
+
+    //グループごとに質量, 質量×座標, 質量×速度を根に集める。
+    //根はグループで一番小さい番号なので、根の値は他の星を足す前に使われる。
+    for (i = 0; i < n; i++) {
+        c->size[i] = 0;
+        for (k = 0; k < 6; k++) {
+            c->sum[i][k] = 0.0;
+        }
+    }
+    int merged = 0;
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        const int root = find(c->parent, i);
+        c->size[root]++;
+        for (k = 0; k < 3; k++) {
+            c->sum[root][k] += m[i] * r[i][k];
+            c->sum[root][3 + k] += m[i] * v[i][k];
+        }
+        if (root != i) {
+            m[root] += m[i];
+            m[i] = 0;
+            merged++;
+        }
+    }
+    for (i = 0; i < n; i++) {
+        if (c->size[i] < 2) continue; //融合しなかった星はそのまま
+        for (k = 0; k < 3; k++) {
+            r[i][k] = c->sum[i][k] / m[i];
+            v[i][k] = c->sum[i][3 + k] / m[i];
+        }
+    }
+    return merged;
+}
@@ -0,0 +1,33 @@
+#ifndef COLLIDE_H
+#define COLLIDE_H
+
+/*
+ * 星の衝突(融合)の判定
+ * 一辺Rの立方体のセルで空間を区切り、セルの番号のハッシュで星を分類する。
+ * 距離がR未満になり得るのは隣り合う27個のセルの星だけなので、全体でO(N)で調べられる。
+ * A が B を、B が C を吸収するような連鎖はUnion-Findで一つのグループにまとめ、
+ * グループの中で番号が一番小さい星に全てを融合する。調べる順序によらず結果は同じになる。
+ */
+
+typedef struct {
+    int cap;        //星の数の上限
+    int table_size; //ハッシュ表の大きさ(2の累乗)
+    int *parent;    //Union-Findの親(根は自分自身)
+    unsigned *key;  //星のいるセルのハッシュ
+    int *start;     //ハッシュごとの星の並びの始まり(table_size + 1個)
+    int *order;     //ハッシュの順に並べた星の番号
+    double (*sum)[6]; //融合するときの質量×座標, 質量×速度の和
+    int *size;      //グループの星の数
+} collider;
+
+void collide_init(collider *c);
+void collide_free(collider *c);
+
+/*
+ * 距離がR未満の星をまとめて融合する。融合した後の星は
+ * 質量が和, 座標が重心, 速度が運動量を保存する値になり、吸収された星の質量は0になる。
+ * 吸収された星の数を返す。
+ */
+int collide_merge(collider *c, int n, double *m, double (*r)[3], double (*v)[3], double R);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "diag.h"
+
+/* 保存量を求める **********************************************************/
+void diag_measure(const force_param *p, int n, const double *m,
+                  const double (*r)[3], const double (*v)[3], diag_state *d)
+{
+    double k = 0.0, mom[3] = {0.0, 0.0, 0.0}, ang[3] = {0.0, 0.0, 0.0};
+
+    for (int i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        k += 0.5 * m[i] * (v[i][0] * v[i][0] + v[i][1] * v[i][1] + v[i][2] * v[i][2]);
+        for (int c = 0; c < 3; c++) {
+            mom[c] += m[i] * v[i][c];
+        }
+        ang[0] += m[i] * (r[i][1] * v[i][2] - r[i][2] * v[i][1]);
+        ang[1] += m[i] * (r[i][2] * v[i][0] - r[i][0] * v[i][2]);
+        ang[2] += m[i] * (r[i][0] * v[i][1] - r[i][1] * v[i][0]);
+    }
+    d->kinetic = k;
+    d->potential = force_potential(p, n, m, r);
+    d->energy = d->kinetic + d->potential;
+    for (int c = 0; c < 3; c++) {
+        d->p[c] = mom[c];
+        d->l[c] = ang[c];
+    }
+}
+
+/* ログ ********************************************************************/
+int diag_open(diag_log *lg, const char *path, int append)
+{
+    lg->ready = 0;
+    if ((lg->fp = fopen(path, append ? "a" : "w")) == NULL) {
+        fprintf(stderr, "error: cannot open %s.\n", path);
+        return -1;
+    }
+    //書き足すときも、空のファイルなら見出しから書く
+    if (ftell(lg->fp) == 0) {
+        fprintf(lg->fp, "# t, step, kinetic, potential, energy, dE/|E0|, |P - P0|, |L - L0|/|L0|\n");
+    }
+    return 0;
+}
+
+void diag_start(diag_log *lg, const diag_state *d)
+{
+    lg->first = *d;
+    lg->ready = 1;
+}
+
+static double distance(const double a[3], const double b[3])
+{
+    const double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void diag_write(diag_log *lg, double t, long step, const diag_state *d)
+{
+    static const double zero[3] = {0.0, 0.0, 0.0};
+
+    if (!lg->ready) {
+        diag_start(lg, d);
+    }
+    const diag_state *f = &lg->first;
+    const double e0 = fabs(f->energy);
+    const double l0 = distance(f->l, zero);
+    fprintf(lg->fp, "%g, %ld, %.10e, %.10e, %.10e, %.3e, %.3e, %.3e\n", t, step,
+            d->kinetic, d->potential, d->energy,
+            e0 > 0 ? (d->energy - f->energy) / e0 : d->energy - f->energy,
+            distance(d->p, f->p),
+            l0 > 0 ? distance(d->l, f->l) / l0 : distance(d->l, f->l));
+    fflush(lg->fp); //途中で止めても読めるように
+}
+
+int diag_close(diag_log *lg)
+{
+    const int result = fclose(lg->fp);
+    lg->fp = NULL;
+    return result == 0 ? 0 : -1;
+}
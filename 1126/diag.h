@@ -0,0 +1,48 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdio.h>
+
+#include "force.h"
+
+/*
+ * 保存量による精度の確認
+ * 運動エネルギー, 位置エネルギー, 運動量, 角運動量(原点のまわり)を求め、
+ * 最初に測った値からのずれをログに書く。
+ * 位置エネルギーは force_potential で求めるので、直接計算でも並列に、
+ * Barnes-Hut, FMMのときは木を使って O(N log N) で求まる。
+ */
+
+typedef struct {
+    double kinetic;   //運動エネルギー
+    double potential; //位置エネルギー
+    double energy;    //全エネルギー
+    double p[3];      //運動量
+    double l[3];      //角運動量
+} diag_state;
+
+typedef struct {
+    FILE *fp;
+    int ready;        //firstが入っていれば1
+    diag_state first; //最初に測った値
+} diag_log;
+
+/* n個の星の保存量を求める */
+void diag_measure(const force_param *p, int n, const double *m,
+                  const double (*r)[3], const double (*v)[3], diag_state *d);
+
+/*
+ * pathを新しく作ってログを始める。appendが0でなければ, 既にあるpathの後ろに書き足す
+ * (チェックポイントから再開したとき)。失敗したら-1
+ */
+int diag_open(diag_log *lg, const char *path, int append);
+
+/* ずれを測る基準の値を決める。呼ばなければ最初にdiag_writeした値を基準にする */
+void diag_start(diag_log *lg, const diag_state *d);
+
+/* 時刻t, ステップstepの値と、基準の値からのずれを1行書く */
+void diag_write(diag_log *lg, double t, long step, const diag_state *d);
+
+int diag_close(diag_log *lg);
+
+#endif
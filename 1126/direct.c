@@ -0,0 +1,615 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include "direct.h"
+
+#define TILE_I 512  //一度に受け持つ星の数(BODIES_PADの倍数)
+#define TILE_J 1024 //一度にキャッシュに載せる相手の星の数
+
+static simd_type current = SIMD_AUTO;
+
+/* 命令セットの名前 ********************************************************/
+int direct_parse_simd(const char *name)
+{
+    if (strcmp(name, "auto") == 0) return SIMD_AUTO;
+    if (strcmp(name, "scalar") == 0) return SIMD_SCALAR;
+    if (strcmp(name, "avx2") == 0) return SIMD_AVX2;
+    if (strcmp(name, "avx512") == 0) return SIMD_AVX512;
+    return -1;
+}
+
+const char *direct_simd_name(simd_type s)
+{
+    switch (s) {
+    case SIMD_AUTO: return "auto";
+    case SIMD_SCALAR: return "scalar";
+    case SIMD_AVX2: return "avx2";
+    case SIMD_AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+/* 命令セットを選ぶ ********************************************************/
+simd_type direct_set_simd(simd_type s)
+{
+    const int has_avx512 = __builtin_cpu_supports("avx512f");
+    const int has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+    if (s == SIMD_AUTO) {
+        s = has_avx512 ? SIMD_AVX512 : (has_avx2 ? SIMD_AVX2 : SIMD_SCALAR);
+    }
+    if (s == SIMD_AVX512 && !has_avx512) s = SIMD_AVX2;
+    if (s == SIMD_AVX2 && !has_avx2) s = SIMD_SCALAR;
+    current = s;
+    return s;
+}
+
+simd_type direct_get_simd(void)
+{
+    return current;
+}
+
+/*
+ * 各カーネルは t の [i, i + W) 番目の点(Wは一度に扱う数)が b の [j0, j1) 番目の星から受ける
+ * 加速度を sx, sy, sz に足し込む。sx, sy, sz はW個ずつの作業領域。
+ */
+
+/* スカラー ****************************************************************/
+static void tile_scalar(const bodies *b, const bodies *t, int i, int j0, int j1, double eps2,
+                        double *sx, double *sy, double *sz)
+{
+    for (int k = 0; k < BODIES_PAD; k++) {
+        const double xi = t->x[i + k], yi = t->y[i + k], zi = t->z[i + k];
+        double ax = sx[k], ay = sy[k], az = sz[k];
+        for (int j = j0; j < j1; j++) {
+            const double dx = b->x[j] - xi;
+            const double dy = b->y[j] - yi;
+            const double dz = b->z[j] - zi;
+            const double r2 = dx * dx + dy * dy + dz * dz + eps2;
+            if (r2 == 0) continue;
+            const double inv = b->m[j] / (r2 * sqrt(r2));
+            ax += dx * inv;
+            ay += dy * inv;
+            az += dz * inv;
+        }
+        sx[k] = ax;
+        sy[k] = ay;
+        sz[k] = az;
+    }
+}
+
+/*
+ * AVX2: 4個の r2 (> 0) の 1/sqrt(r2) を倍精度で求める
+ * 近似値は倍精度のビット列から作り(相対誤差3.5%程度)、ニュートン法4回で倍精度まで上げる。
+ * 単精度の _mm_rsqrt_ps を使うと、単精度の範囲の外(FLT_MIN未満, FLT_MAXより大)の r2 で
+ * 近似値が無限大か0になり、結果が壊れる。こちらは倍精度の範囲全体で使える。
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256d rsqrt_avx2(__m256d r2)
+{
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d three_half = _mm256_set1_pd(1.5);
+    const __m256i magic = _mm256_set1_epi64x(0x5fe6eb50c7b537a9LL);
+
+    //ビット列を整数として扱い、指数を -1/2 倍した値を引き算で作る
+    __m256d y = _mm256_castsi256_pd(_mm256_sub_epi64(magic, _mm256_srli_epi64(_mm256_castpd_si256(r2), 1)));
+    const __m256d hr2 = _mm256_mul_pd(half, r2);
+    y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hr2, _mm256_mul_pd(y, y), three_half));
+    y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hr2, _mm256_mul_pd(y, y), three_half));
+    y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hr2, _mm256_mul_pd(y, y), three_half));
+    y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hr2, _mm256_mul_pd(y, y), three_half));
+    return y;
+}
+
+/* AVX2: 4個の星をまとめて計算する *****************************************/
+__attribute__((target("avx2,fma")))
+static void tile_avx2(const bodies *b, const bodies *t, int i, int j0, int j1, double eps2,
+                      double *sx, double *sy, double *sz)
+{
+    const __m256d veps2 = _mm256_set1_pd(eps2);
+    const __m256d zero = _mm256_setzero_pd();
+
+    for (int k = 0; k < BODIES_PAD; k += 4) {
+        const __m256d xi = _mm256_load_pd(&t->x[i + k]);
+        const __m256d yi = _mm256_load_pd(&t->y[i + k]);
+        const __m256d zi = _mm256_load_pd(&t->z[i + k]);
+        __m256d ax = _mm256_load_pd(&sx[k]);
+        __m256d ay = _mm256_load_pd(&sy[k]);
+        __m256d az = _mm256_load_pd(&sz[k]);
+        for (int j = j0; j < j1; j++) {
+            const __m256d dx = _mm256_sub_pd(_mm256_broadcast_sd(&b->x[j]), xi);
+            const __m256d dy = _mm256_sub_pd(_mm256_broadcast_sd(&b->y[j]), yi);
+            const __m256d dz = _mm256_sub_pd(_mm256_broadcast_sd(&b->z[j]), zi);
+            __m256d r2 = _mm256_fmadd_pd(dx, dx, veps2);
+            r2 = _mm256_fmadd_pd(dy, dy, r2);
+            r2 = _mm256_fmadd_pd(dz, dz, r2);
+            const __m256d mask = _mm256_cmp_pd(r2, zero, _CMP_GT_OQ);
+            const __m256d y = rsqrt_avx2(r2);
+            __m256d inv = _mm256_mul_pd(_mm256_broadcast_sd(&b->m[j]), _mm256_mul_pd(y, _mm256_mul_pd(y, y)));
+            inv = _mm256_and_pd(inv, mask); //距離0の組は無限大になるので消す
+            ax = _mm256_fmadd_pd(dx, inv, ax);
+            ay = _mm256_fmadd_pd(dy, inv, ay);
+            az = _mm256_fmadd_pd(dz, inv, az);
+        }
+        _mm256_store_pd(&sx[k], ax);
+        _mm256_store_pd(&sy[k], ay);
+        _mm256_store_pd(&sz[k], az);
+    }
+}
+
+/* AVX-512: 8個の星をまとめて計算する **************************************/
+__attribute__((target("avx512f")))
+static void tile_avx512(const bodies *b, const bodies *t, int i, int j0, int j1, double eps2,
+                        double *sx, double *sy, double *sz)
+{
+    const __m512d veps2 = _mm512_set1_pd(eps2);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d three_half = _mm512_set1_pd(1.5);
+
+    const __m512d xi = _mm512_load_pd(&t->x[i]);
+    const __m512d yi = _mm512_load_pd(&t->y[i]);
+    const __m512d zi = _mm512_load_pd(&t->z[i]);
+    __m512d ax = _mm512_load_pd(sx);
+    __m512d ay = _mm512_load_pd(sy);
+    __m512d az = _mm512_load_pd(sz);
+    for (int j = j0; j < j1; j++) {
+        const __m512d dx = _mm512_sub_pd(_mm512_set1_pd(b->x[j]), xi);
+        const __m512d dy = _mm512_sub_pd(_mm512_set1_pd(b->y[j]), yi);
+        const __m512d dz = _mm512_sub_pd(_mm512_set1_pd(b->z[j]), zi);
+        __m512d r2 = _mm512_fmadd_pd(dx, dx, veps2);
+        r2 = _mm512_fmadd_pd(dy, dy, r2);
+        r2 = _mm512_fmadd_pd(dz, dz, r2);
+        const __mmask8 mask = _mm512_cmp_pd_mask(r2, zero, _CMP_GT_OQ);
+        //近似値 1/sqrt(r2) (14ビット)をニュートン法2回で倍精度まで上げる
+        __m512d y = _mm512_rsqrt14_pd(r2);
+        const __m512d hr2 = _mm512_mul_pd(half, r2);
+        y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hr2, _mm512_mul_pd(y, y), three_half));
+        y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hr2, _mm512_mul_pd(y, y), three_half));
+        const __m512d inv = _mm512_maskz_mul_pd(mask, _mm512_set1_pd(b->m[j]),
+                                                _mm512_mul_pd(y, _mm512_mul_pd(y, y)));
+        ax = _mm512_fmadd_pd(dx, inv, ax);
+        ay = _mm512_fmadd_pd(dy, inv, ay);
+        az = _mm512_fmadd_pd(dz, inv, az);
+    }
+    _mm512_store_pd(sx, ax);
+    _mm512_store_pd(sy, ay);
+    _mm512_store_pd(sz, az);
+}
+
+/*
+ * 作用反作用を使う版
+ * ブロックIの星iを4個ずつ取り、ブロックJの星jを4個 / 8個ずつまとめて計算する。
+ * jの座標と加速度は4個のiの間レジスタに置いたままにし、作業領域の読み書きを1/4にする。
+ * iの加速度はレジスタに溜めて最後に足す。
+ * 対角のブロック (I == J) では i < j の組だけを数える。iを含むjの組から始め、
+ * j <= i のレーンを消す。
+ * iは4個ずつ進めるので、ブロックの終わりの端数では星の数を超えたところまで読む。
+ * そこは質量0の星(bodies.hの余り)で、作業領域もbodies_padded(n)まであるので結果は変わらない。
+ */
+
+/* スカラー ****************************************************************/
+static void pair_scalar(const bodies *b, int i0, int i1, int j0, int j1, double eps2,
+                        double *ax, double *ay, double *az)
+{
+    for (int i = i0; i < i1; i++) {
+        const double xi = b->x[i], yi = b->y[i], zi = b->z[i], mi = b->m[i];
+        double sx = 0.0, sy = 0.0, sz = 0.0;
+        //同じブロックの中では i < j の組だけを数える
+        for (int j = (i0 == j0 ? i + 1 : j0); j < j1; j++) {
+            const double dx = b->x[j] - xi;
+            const double dy = b->y[j] - yi;
+            const double dz = b->z[j] - zi;
+            const double r2 = dx * dx + dy * dy + dz * dz + eps2;
+            if (r2 == 0) continue;
+            const double s = 1.0 / (r2 * sqrt(r2));
+            const double si = b->m[j] * s;
+            const double sj = mi * s;
+            sx += dx * si;
+            sy += dy * si;
+            sz += dz * si;
+            ax[j] -= dx * sj;
+            ay[j] -= dy * sj;
+            az[j] -= dz * sj;
+        }
+        ax[i] += sx;
+        ay[i] += sy;
+        az[i] += sz;
+    }
+}
+
+/* AVX2: 4個のiと4個のjをまとめて計算する *******************************/
+__attribute__((target("avx2,fma")))
+static void pair_avx2(const bodies *b, int i0, int i1, int j0, int j1, double eps2,
+                      double *ax, double *ay, double *az)
+{
+    const __m256d veps2 = _mm256_set1_pd(eps2);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d all = _mm256_cmp_pd(zero, zero, _CMP_EQ_OQ);
+    const __m256d lane = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+    for (int i = i0; i < i1; i += 4) {
+        __m256d sx[4], sy[4], sz[4];
+        for (int k = 0; k < 4; k++) {
+            sx[k] = sy[k] = sz[k] = zero;
+        }
+        for (int j = i0 == j0 ? i : j0; j < j1; j += 4) {
+            const __m256d xj = _mm256_load_pd(&b->x[j]);
+            const __m256d yj = _mm256_load_pd(&b->y[j]);
+            const __m256d zj = _mm256_load_pd(&b->z[j]);
+            const __m256d mj = _mm256_load_pd(&b->m[j]);
+            __m256d tx = _mm256_load_pd(&ax[j]);
+            __m256d ty = _mm256_load_pd(&ay[j]);
+            __m256d tz = _mm256_load_pd(&az[j]);
+            for (int k = 0; k < 4; k++) {
+                __m256d keep = all;
+                if (j <= i + k) { //対角のブロックでは j > i のレーンだけを残す
+                    keep = _mm256_cmp_pd(_mm256_add_pd(lane, _mm256_set1_pd((double) j)),
+                                         _mm256_set1_pd((double) (i + k)), _CMP_GT_OQ);
+                }
+                const __m256d dx = _mm256_sub_pd(xj, _mm256_broadcast_sd(&b->x[i + k]));
+                const __m256d dy = _mm256_sub_pd(yj, _mm256_broadcast_sd(&b->y[i + k]));
+                const __m256d dz = _mm256_sub_pd(zj, _mm256_broadcast_sd(&b->z[i + k]));
+                __m256d r2 = _mm256_fmadd_pd(dx, dx, veps2);
+                r2 = _mm256_fmadd_pd(dy, dy, r2);
+                r2 = _mm256_fmadd_pd(dz, dz, r2);
+                const __m256d mask = _mm256_and_pd(keep, _mm256_cmp_pd(r2, zero, _CMP_GT_OQ));
+                const __m256d y = rsqrt_avx2(r2);
+                const __m256d s = _mm256_and_pd(_mm256_mul_pd(y, _mm256_mul_pd(y, y)), mask);
+                const __m256d si = _mm256_mul_pd(mj, s);
+                const __m256d sj = _mm256_mul_pd(_mm256_broadcast_sd(&b->m[i + k]), s);
+                sx[k] = _mm256_fmadd_pd(dx, si, sx[k]);
+                sy[k] = _mm256_fmadd_pd(dy, si, sy[k]);
+                sz[k] = _mm256_fmadd_pd(dz, si, sz[k]);
+                tx = _mm256_fnmadd_pd(dx, sj, tx);
+                ty = _mm256_fnmadd_pd(dy, sj, ty);
+                tz = _mm256_fnmadd_pd(dz, sj, tz);
+            }
+            _mm256_store_pd(&ax[j], tx);
+            _mm256_store_pd(&ay[j], ty);
+            _mm256_store_pd(&az[j], tz);
+        }
+        for (int k = 0; k < 4; k++) {
+            double tx[4], ty[4], tz[4];
+            _mm256_storeu_pd(tx, sx[k]);
+            _mm256_storeu_pd(ty, sy[k]);
+            _mm256_storeu_pd(tz, sz[k]);
+            ax[i + k] += (tx[0] + tx[1]) + (tx[2] + tx[3]);
+            ay[i + k] += (ty[0] + ty[1]) + (ty[2] + ty[3]);
+            az[i + k] += (tz[0] + tz[1]) + (tz[2] + tz[3]);
+        }
+    }
+}
+
+/* AVX-512: 4個のiと8個のjをまとめて計算する ****************************/
+__attribute__((target("avx512f")))
+static void pair_avx512(const bodies *b, int i0, int i1, int j0, int j1, double eps2,
+                        double *ax, double *ay, double *az)
+{
+    const __m512d veps2 = _mm512_set1_pd(eps2);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d three_half = _mm512_set1_pd(1.5);
+    const __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+
+    for (int i = i0; i < i1; i += 4) {
+        __m512d sx[4], sy[4], sz[4];
+        for (int k = 0; k < 4; k++) {
+            sx[k] = sy[k] = sz[k] = zero;
+        }
+        for (int j = i0 == j0 ? i / 8 * 8 : j0; j < j1; j += 8) {
+            const __m512d xj = _mm512_load_pd(&b->x[j]);
+            const __m512d yj = _mm512_load_pd(&b->y[j]);
+            const __m512d zj = _mm512_load_pd(&b->z[j]);
+            const __m512d mj = _mm512_load_pd(&b->m[j]);
+            __m512d tx = _mm512_load_pd(&ax[j]);
+            __m512d ty = _mm512_load_pd(&ay[j]);
+            __m512d tz = _mm512_load_pd(&az[j]);
+            for (int k = 0; k < 4; k++) {
+                __mmask8 keep = 0xff;
+                if (j <= i + k) { //対角のブロックでは j > i のレーンだけを残す
+                    keep = _mm512_cmpgt_epi64_mask(_mm512_add_epi64(lane, _mm512_set1_epi64(j)),
+                                                   _mm512_set1_epi64(i + k));
+                }
+                const __m512d dx = _mm512_sub_pd(xj, _mm512_set1_pd(b->x[i + k]));
+                const __m512d dy = _mm512_sub_pd(yj, _mm512_set1_pd(b->y[i + k]));
+                const __m512d dz = _mm512_sub_pd(zj, _mm512_set1_pd(b->z[i + k]));
+                __m512d r2 = _mm512_fmadd_pd(dx, dx, veps2);
+                r2 = _mm512_fmadd_pd(dy, dy, r2);
+                r2 = _mm512_fmadd_pd(dz, dz, r2);
+                const __mmask8 mask = _mm512_mask_cmp_pd_mask(keep, r2, zero, _CMP_GT_OQ);
+                __m512d y = _mm512_rsqrt14_pd(r2);
+                const __m512d hr2 = _mm512_mul_pd(half, r2);
+                y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hr2, _mm512_mul_pd(y, y), three_half));
+                y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hr2, _mm512_mul_pd(y, y), three_half));
+                const __m512d s = _mm512_maskz_mul_pd(mask, y, _mm512_mul_pd(y, y));
+                const __m512d si = _mm512_mul_pd(mj, s);
+                const __m512d sj = _mm512_mul_pd(_mm512_set1_pd(b->m[i + k]), s);
+                sx[k] = _mm512_fmadd_pd(dx, si, sx[k]);
+                sy[k] = _mm512_fmadd_pd(dy, si, sy[k]);
+                sz[k] = _mm512_fmadd_pd(dz, si, sz[k]);
+                tx = _mm512_fnmadd_pd(dx, sj, tx);
+                ty = _mm512_fnmadd_pd(dy, sj, ty);
+                tz = _mm512_fnmadd_pd(dz, sj, tz);
+            }
+            _mm512_store_pd(&ax[j], tx);
+            _mm512_store_pd(&ay[j], ty);
+            _mm512_store_pd(&az[j], tz);
+        }
+        for (int k = 0; k < 4; k++) {
+            ax[i + k] += _mm512_reduce_add_pd(sx[k]);
+            ay[i + k] += _mm512_reduce_add_pd(sy[k]);
+            az[i + k] += _mm512_reduce_add_pd(sz[k]);
+        }
+    }
+}
+
+/* 仕事の数 ****************************************************************/
+int direct_pair_count(const bodies *b)
+{
+    const int nb = (b->n + DIRECT_BLOCK - 1) / DIRECT_BLOCK;
+    return nb * (nb + 1) / 2;
+}
+
+/* t番目の仕事 *************************************************************/
+void direct_pair(const bodies *b, int t, double eps2,
+                 double *ax, double *ay, double *az)
+{
+    const int nb = (b->n + DIRECT_BLOCK - 1) / DIRECT_BLOCK;
+    int I = 0;
+    //t番目の組 (I, J) を求める: I行目には nb - I 個の組がある
+    while (t >= nb - I) {
+        t -= nb - I;
+        I++;
+    }
+    const int J = I + t;
+    const int npad = bodies_padded(b->n);
+    const int i0 = I * DIRECT_BLOCK;
+    const int i1 = i0 + DIRECT_BLOCK < b->n ? i0 + DIRECT_BLOCK : b->n;
+    const int j0 = J * DIRECT_BLOCK;
+    const int j1 = j0 + DIRECT_BLOCK < npad ? j0 + DIRECT_BLOCK : npad;
+
+    switch (current) {
+    case SIMD_AVX512:
+        pair_avx512(b, i0, i1, j0, j1, eps2, ax, ay, az);
+        break;
+    case SIMD_AVX2:
+        pair_avx2(b, i0, i1, j0, j1, eps2, ax, ay, az);
+        break;
+    default:
+        pair_scalar(b, i0, i1, j0, j1, eps2, ax, ay, az);
+        break;
+    }
+}
+
+/* 加速度計算 **************************************************************/
+void direct_accel(const bodies *b, int i0, int i1, double eps2,
+                  double *ax, double *ay, double *az)
+{
+    direct_accel_at(b, b, i0, i1, eps2, ax, ay, az);
+}
+
+void direct_accel_at(const bodies *b, const bodies *t, int i0, int i1, double eps2,
+                     double *ax, double *ay, double *az)
+{
+    void (*tile)(const bodies *, const bodies *, int, int, int, double,
+                 double *, double *, double *);
+    //TILE_I個の星の加速度を作業領域に持ち、相手の星をTILE_J個ずつキャッシュに載せて使い回す
+    double sx[TILE_I] __attribute__((aligned(64)));
+    double sy[TILE_I] __attribute__((aligned(64)));
+    double sz[TILE_I] __attribute__((aligned(64)));
+    const int npad = bodies_padded(b->n);
+
+    switch (current) {
+    case SIMD_AVX512:
+        tile = tile_avx512;
+        break;
+    case SIMD_AVX2:
+        tile = tile_avx2;
+        break;
+    default:
+        tile = tile_scalar;
+        break;
+    }
+
+    for (int ib = i0; ib < i1; ib += TILE_I) {
+        const int ie = ib + TILE_I < i1 ? ib + TILE_I : i1;
+        const int ie_pad = bodies_padded(ie - ib) + ib;
+        for (int k = 0; k < ie_pad - ib; k++) {
+            sx[k] = sy[k] = sz[k] = 0.0;
+        }
+        for (int jb = 0; jb < npad; jb += TILE_J) {
+            const int je = jb + TILE_J < npad ? jb + TILE_J : npad;
+            for (int i = ib; i < ie_pad; i += BODIES_PAD) {
+                tile(b, t, i, jb, je, eps2, &sx[i - ib], &sy[i - ib], &sz[i - ib]);
+            }
+        }
+        for (int i = ib; i < ie; i++) {
+            ax[i] = sx[i - ib];
+            ay[i] = sy[i - ib];
+            az[i] = sz[i - ib];
+        }
+    }
+}
+
+void direct_accel_add(const bodies *b, int j0, int j1, const bodies *t, int i0, int i1,
+                      double eps2, double *ax, double *ay, double *az)
+{
+    void (*tile)(const bodies *, const bodies *, int, int, int, double,
+                 double *, double *, double *);
+
+    switch (current) {
+    case SIMD_AVX512:
+        tile = tile_avx512;
+        break;
+    case SIMD_AVX2:
+        tile = tile_avx2;
+        break;
+    default:
+        tile = tile_scalar;
+        break;
+    }
+
+    for (int i = i0; i < i1; i += BODIES_PAD) {
+        tile(b, t, i, j0, j1, eps2, &ax[i], &ay[i], &az[i]);
+    }
+}
+
+/*
+ * 混合精度の版
+ * 組ごとの差・距離・逆数平方根は単精度で計算し、相手の星TILE_J個分の和を単精度で溜めてから
+ * 倍精度の作業領域に足す。TILE_J個の和の丸め誤差は相対で1e-4程度に収まり、
+ * 倍精度の和に移すので星の数が増えても誤差は積み重ならない。
+ * 各カーネルは t の [i, i + BODIES_F_PAD) 番目の点について足し込む。
+ */
+
+/* スカラー ****************************************************************/
+static void mixed_scalar(const bodies_f *b, const bodies_f *t, int i, int j0, int j1, float eps2,
+                         double *sx, double *sy, double *sz)
+{
+    for (int k = 0; k < BODIES_F_PAD; k++) {
+        const float xi = t->x[i + k], yi = t->y[i + k], zi = t->z[i + k];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        for (int j = j0; j < j1; j++) {
+            const float dx = b->x[j] - xi;
+            const float dy = b->y[j] - yi;
+            const float dz = b->z[j] - zi;
+            const float r2 = dx * dx + dy * dy + dz * dz + eps2;
+            if (r2 == 0) continue;
+            const float inv = b->m[j] / (r2 * sqrtf(r2));
+            ax += dx * inv;
+            ay += dy * inv;
+            az += dz * inv;
+        }
+        sx[k] += ax;
+        sy[k] += ay;
+        sz[k] += az;
+    }
+}
+
+/* AVX2: 8個の星をまとめて計算する *****************************************/
+__attribute__((target("avx2,fma")))
+static void mixed_avx2(const bodies_f *b, const bodies_f *t, int i, int j0, int j1, float eps2,
+                       double *sx, double *sy, double *sz)
+{
+    const __m256 veps2 = _mm256_set1_ps(eps2);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three_half = _mm256_set1_ps(1.5f);
+
+    for (int k = 0; k < BODIES_F_PAD; k += 8) {
+        const __m256 xi = _mm256_load_ps(&t->x[i + k]);
+        const __m256 yi = _mm256_load_ps(&t->y[i + k]);
+        const __m256 zi = _mm256_load_ps(&t->z[i + k]);
+        __m256 ax = zero, ay = zero, az = zero;
+        for (int j = j0; j < j1; j++) {
+            const __m256 dx = _mm256_sub_ps(_mm256_broadcast_ss(&b->x[j]), xi);
+            const __m256 dy = _mm256_sub_ps(_mm256_broadcast_ss(&b->y[j]), yi);
+            const __m256 dz = _mm256_sub_ps(_mm256_broadcast_ss(&b->z[j]), zi);
+            __m256 r2 = _mm256_fmadd_ps(dx, dx, veps2);
+            r2 = _mm256_fmadd_ps(dy, dy, r2);
+            r2 = _mm256_fmadd_ps(dz, dz, r2);
+            const __m256 mask = _mm256_cmp_ps(r2, zero, _CMP_GT_OQ);
+            //近似値 1/sqrt(r2) (12ビット)をニュートン法1回で単精度まで上げる
+            __m256 y = _mm256_rsqrt_ps(r2);
+            y = _mm256_mul_ps(y, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(y, y), three_half));
+            __m256 inv = _mm256_mul_ps(_mm256_broadcast_ss(&b->m[j]), _mm256_mul_ps(y, _mm256_mul_ps(y, y)));
+            inv = _mm256_and_ps(inv, mask);
+            ax = _mm256_fmadd_ps(dx, inv, ax);
+            ay = _mm256_fmadd_ps(dy, inv, ay);
+            az = _mm256_fmadd_ps(dz, inv, az);
+        }
+        //前半4個と後半4個を倍精度に直して足す
+        _mm256_store_pd(&sx[k], _mm256_add_pd(_mm256_load_pd(&sx[k]), _mm256_cvtps_pd(_mm256_castps256_ps128(ax))));
+        _mm256_store_pd(&sy[k], _mm256_add_pd(_mm256_load_pd(&sy[k]), _mm256_cvtps_pd(_mm256_castps256_ps128(ay))));
+        _mm256_store_pd(&sz[k], _mm256_add_pd(_mm256_load_pd(&sz[k]), _mm256_cvtps_pd(_mm256_castps256_ps128(az))));
+        _mm256_store_pd(&sx[k + 4], _mm256_add_pd(_mm256_load_pd(&sx[k + 4]), _mm256_cvtps_pd(_mm256_extractf128_ps(ax, 1))));
+        _mm256_store_pd(&sy[k + 4], _mm256_add_pd(_mm256_load_pd(&sy[k + 4]), _mm256_cvtps_pd(_mm256_extractf128_ps(ay, 1))));
+        _mm256_store_pd(&sz[k + 4], _mm256_add_pd(_mm256_load_pd(&sz[k + 4]), _mm256_cvtps_pd(_mm256_extractf128_ps(az, 1))));
+    }
+}
+
+/* AVX-512: 16個の星をまとめて計算する *************************************/
+__attribute__((target("avx512f")))
+static void mixed_avx512(const bodies_f *b, const bodies_f *t, int i, int j0, int j1, float eps2,
+                         double *sx, double *sy, double *sz)
+{
+    const __m512 veps2 = _mm512_set1_ps(eps2);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three_half = _mm512_set1_ps(1.5f);
+
+    const __m512 xi = _mm512_load_ps(&t->x[i]);
+    const __m512 yi = _mm512_load_ps(&t->y[i]);
+    const __m512 zi = _mm512_load_ps(&t->z[i]);
+    __m512 ax = zero, ay = zero, az = zero;
+    for (int j = j0; j < j1; j++) {
+        const __m512 dx = _mm512_sub_ps(_mm512_set1_ps(b->x[j]), xi);
+        const __m512 dy = _mm512_sub_ps(_mm512_set1_ps(b->y[j]), yi);
+        const __m512 dz = _mm512_sub_ps(_mm512_set1_ps(b->z[j]), zi);
+        __m512 r2 = _mm512_fmadd_ps(dx, dx, veps2);
+        r2 = _mm512_fmadd_ps(dy, dy, r2);
+        r2 = _mm512_fmadd_ps(dz, dz, r2);
+        const __mmask16 mask = _mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ);
+        //近似値 1/sqrt(r2) (14ビット)をニュートン法1回で単精度まで上げる
+        __m512 y = _mm512_rsqrt14_ps(r2);
+        y = _mm512_mul_ps(y, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(y, y), three_half));
+        const __m512 inv = _mm512_maskz_mul_ps(mask, _mm512_set1_ps(b->m[j]),
+                                               _mm512_mul_ps(y, _mm512_mul_ps(y, y)));
+        ax = _mm512_fmadd_ps(dx, inv, ax);
+        ay = _mm512_fmadd_ps(dy, inv, ay);
+        az = _mm512_fmadd_ps(dz, inv, az);
+    }
+    //前半8個と後半8個を倍精度に直して足す
+    _mm512_store_pd(&sx[0], _mm512_add_pd(_mm512_load_pd(&sx[0]), _mm512_cvtps_pd(_mm512_castps512_ps256(ax))));
+    _mm512_store_pd(&sy[0], _mm512_add_pd(_mm512_load_pd(&sy[0]), _mm512_cvtps_pd(_mm512_castps512_ps256(ay))));
+    _mm512_store_pd(&sz[0], _mm512_add_pd(_mm512_load_pd(&sz[0]), _mm512_cvtps_pd(_mm512_castps512_ps256(az))));
+    _mm512_store_pd(&sx[8], _mm512_add_pd(_mm512_load_pd(&sx[8]), _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(ax), 1)))));
+    _mm512_store_pd(&sy[8], _mm512_add_pd(_mm512_load_pd(&sy[8]), _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(ay), 1)))));
+    _mm512_store_pd(&sz[8], _mm512_add_pd(_mm512_load_pd(&sz[8]), _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(az), 1)))));
+}
+
+/* 混合精度の加速度計算 ****************************************************/
+void direct_accel_mixed(const bodies_f *b, const bodies_f *t, int i0, int i1, float eps2,
+                        double *ax, double *ay, double *az)
+{
+    void (*tile)(const bodies_f *, const bodies_f *, int, int, int, float,
+                 double *, double *, double *);
+    double sx[TILE_I] __attribute__((aligned(64)));
+    double sy[TILE_I] __attribute__((aligned(64)));
+    double sz[TILE_I] __attribute__((aligned(64)));
+    const int npad = bodies_f_padded(b->n);
+
+    switch (current) {
+    case SIMD_AVX512:
+        tile = mixed_avx512;
+        break;
+    case SIMD_AVX2:
+        tile = mixed_avx2;
+        break;
+    default:
+        tile = mixed_scalar;
+        break;
+    }
+
+    for (int ib = i0; ib < i1; ib += TILE_I) {
+        const int ie = ib + TILE_I < i1 ? ib + TILE_I : i1;
+        const int ie_pad = bodies_f_padded(ie - ib) + ib;
+        for (int k = 0; k < ie_pad - ib; k++) {
+            sx[k] = sy[k] = sz[k] = 0.0;
+        }
+        for (int jb = 0; jb < npad; jb += TILE_J) {
+            const int je = jb + TILE_J < npad ? jb + TILE_J : npad;
+            for (int i = ib; i < ie_pad; i += BODIES_F_PAD) {
+                tile(b, t, i, jb, je, eps2, &sx[i - ib], &sy[i - ib], &sz[i - ib]);
+            }
+        }
+        for (int i = ib; i < ie; i++) {
+            ax[i] = sx[i - ib];
+            ay[i] = sy[i - ib];
+            az[i] = sz[i - ib];
+        }
+    }
+}
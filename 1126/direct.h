@@ -0,0 +1,81 @@
+#ifndef DIRECT_H
+#define DIRECT_H
+
+#include "bodies.h"
+
+/*
+ * 直接計算による加速度 (G = 1)
+ * 星を成分ごとの配列に並べ、AVX2 / AVX-512 で4個 / 8個の星の加速度を同時に足し込む。
+ * 使う命令セットは実行時にCPUを調べて選ぶ。どちらもなければスカラーで計算する。
+ */
+
+typedef enum {
+    SIMD_AUTO,   //使える中で一番速いもの
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+} simd_type;
+
+/* "auto", "scalar", "avx2", "avx512" を simd_type に直す。知らない名前なら-1 */
+int direct_parse_simd(const char *name);
+const char *direct_simd_name(simd_type s);
+
+/*
+ * 使う命令セットを選ぶ。CPUが対応していなければ、使えるものに落として選んだものを返す。
+ * 計算の関数はスレッドプールから同時に呼ばれ、選んだものを読むだけなので、
+ * スレッドで計算を始める前にメインのスレッドで呼ぶこと(force_initがSIMD_AUTOで呼ぶ)。
+ * 一度も呼ばなければスカラーで計算する。
+ */
+simd_type direct_set_simd(simd_type s);
+
+/* 今選ばれている命令セット(まだ選んでいなければSIMD_AUTO) */
+simd_type direct_get_simd(void);
+
+/*
+ * b の全ての星から受ける、[i0, i1) 番目の星の加速度を ax, ay, az に書き込む。
+ * 距離が0になる組(自分自身)は足さない。
+ * i0はBODIES_PADの倍数にすること(端数の星もまとめて読むため)。
+ */
+void direct_accel(const bodies *b, int i0, int i1, double eps2,
+                  double *ax, double *ay, double *az);
+
+/*
+ * b の全ての星から受ける、t の [i0, i1) 番目の点の加速度を求める。
+ * 一部の星だけの加速度を求めるときに、その星の座標を t に集めて使う。
+ */
+void direct_accel_at(const bodies *b, const bodies *t, int i0, int i1, double eps2,
+                     double *ax, double *ay, double *az);
+
+/*
+ * b の [j0, j1) 番目の星から受ける、t の [i0, i1) 番目の点の加速度を ax, ay, az に足し込む。
+ * 木を使う方法で、近い節点の組を直接計算するときに使う。
+ * i0, i1 はBODIES_PADの倍数にし、ax, ay, az は64バイト境界にそろえること。
+ */
+void direct_accel_add(const bodies *b, int j0, int j1, const bodies *t, int i0, int i1,
+                      double eps2, double *ax, double *ay, double *az);
+
+/*
+ * 混合精度版の direct_accel_at。
+ * 組ごとの計算は単精度で行い、加速度の和は倍精度で持つ。b, t は bodies_f_from() で
+ * 同じ原点から作ったものを使う。i0はBODIES_F_PADの倍数にすること。
+ * 加速度の相対誤差は1e-6程度で、倍精度版の2倍以上速い。
+ */
+void direct_accel_mixed(const bodies_f *b, const bodies_f *t, int i0, int i1, float eps2,
+                        double *ax, double *ay, double *az);
+
+/*
+ * 作用反作用を使って、一つの組を一度だけ計算する。
+ * 星を DIRECT_BLOCK 個ずつのブロックに分け、ブロックの組 (I, J) (I <= J) を一つの仕事とする。
+ * direct_pair_count() は仕事の数、direct_pair() は t 番目の仕事を計算して
+ * ax, ay, az (長さはbodies_padded(n)以上) に足し込む。ax, ay, az はスレッドごとに分けること。
+ * 質量も掛けた加速度 (G = 1) を足すので、受け手側の質量が0でも正しく扱える。
+ * 組の数は半分になるが、一つの組で両方の星に足すぶん計算が増えるので、速さは
+ * direct_accel の2倍には届かない(AVX-512で N = 1e4 で1.5倍, 3e4 で1.7倍程度)。
+ */
+#define DIRECT_BLOCK 256
+
+int direct_pair_count(const bodies *b);
+void direct_pair(const bodies *b, int t, double eps2,
+                 double *ax, double *ay, double *az);
+
+#endif
@@ -0,0 +1,604 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "fmm.h"
+#include "pool.h"
+#include "direct.h"
+
+#define LEAF_SIZE 64 //葉に入れる星の数の上限
+#define P2P_MAX 256  //星の数の積がこれ以下の組は展開せずに直接計算する
+#define M2L_MIN 128  //星の数の積がこれ以下の組は、離れていてもM2Lより直接計算の方が速い
+#define NTASK 128    //木をおおよそこの数の部分木に分けて、スレッドに配る
+#define M2L_BATCH 8  //まとめて計算するM2Lの組の数
+
+static double binom(int n, int k)
+{
+    double r = 1.0;
+    for (int i = 1; i <= k; i++) {
+        r = r * (n - k + i) / i;
+    }
+    return r;
+}
+
+static void add_term(fmm_term **list, int *len, int *cap, int o, int i, int x, double c)
+{
+    if (*len == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        *list = (fmm_term *) realloc(*list, sizeof(fmm_term) * (size_t) *cap);
+    }
+    (*list)[*len].o = o;
+    (*list)[*len].i = i;
+    (*list)[*len].x = x;
+    (*list)[*len].c = c;
+    (*len)++;
+}
+
+/* f->orderの表を作る ****************************************************/
+/*
+ * 展開の係数は多重指数 n = (a, b, c), |n| = a + b + c <= order で番号付けする。
+ * 次数の低い順に並べるので、漸化式は番号の小さい方から順に計算できる。
+ * 係数の定義(y は展開の中心から見た星の位置、u は局所展開の中心からの変位):
+ *   M[n] = Σ m y^n
+ *   Φ(z + u) = Σ L[k] u^k   (Φ = Σ m / |x - x_j|, 加速度は ∇Φ)
+ */
+static void make_tables(fmm *f)
+{
+    fmm_tables *tb = &f->tab;
+    const int order = f->order;
+    int a, b, c, n, k, ncoef;
+    if (order == tb->order) return;
+    tb->order = order;
+
+    ncoef = 0;
+    for (int t = 0; t <= order; t++) {
+        for (a = t; a >= 0; a--) {
+            for (b = t - a; b >= 0; b--) {
+                c = t - a - b;
+                tb->ex[0][ncoef] = a;
+                tb->ex[1][ncoef] = b;
+                tb->ex[2][ncoef] = c;
+                tb->idx_of[a][b][c] = ncoef++;
+            }
+        }
+    }
+
+    for (n = 1; n < ncoef; n++) {
+        const int e[3] = {tb->ex[0][n], tb->ex[1][n], tb->ex[2][n]};
+        const int t = e[0] + e[1] + e[2];
+        fmm_recur *q = &tb->rec[n];
+        q->n1 = q->n2 = 0;
+        for (int i = 0; i < 3; i++) {
+            if (e[i] >= 1) {
+                int g[3] = {e[0], e[1], e[2]};
+                g[i] -= 1;
+                q->dir1[q->n1] = i;
+                q->idx1[q->n1++] = tb->idx_of[g[0]][g[1]][g[2]];
+            }
+            if (e[i] >= 2) {
+                int g[3] = {e[0], e[1], e[2]};
+                g[i] -= 2;
+                q->idx2[q->n2++] = tb->idx_of[g[0]][g[1]][g[2]];
+            }
+        }
+        q->c1 = (2.0 * t - 1) / t;
+        q->c2 = (t - 1.0) / t;
+    }
+
+    int cap_m2m = 0, cap_m2l = 0, cap_l2l = 0;
+    tb->nm2m = tb->nm2l = tb->nl2l = 0;
+    //M2Lは出力の係数ごとにまとめて並べる(和をレジスタに持ったまま足せるように)
+    for (k = 0; k < ncoef; k++) {
+        tb->m2l_start[k] = tb->nm2l;
+        for (n = 0; n < ncoef; n++) {
+            const int sa = tb->ex[0][n] + tb->ex[0][k];
+            const int sb = tb->ex[1][n] + tb->ex[1][k];
+            const int sc = tb->ex[2][n] + tb->ex[2][k];
+            if (sa + sb + sc > order) continue;
+            const double cb = binom(sa, tb->ex[0][k]) * binom(sb, tb->ex[1][k]) * binom(sc, tb->ex[2][k]);
+            const int degn = tb->ex[0][n] + tb->ex[1][n] + tb->ex[2][n];
+            //L[k] += (-1)^|n| C(n + k, n) M[n] T[n + k]
+            add_term(&tb->m2l, &tb->nm2l, &cap_m2l, k, n, tb->idx_of[sa][sb][sc], (degn % 2 ? -1.0 : 1.0) * cb);
+        }
+    }
+    tb->m2l_start[ncoef] = tb->nm2l;
+    for (n = 0; n < ncoef; n++) {
+        for (k = 0; k < ncoef; k++) {
+            const int sa = tb->ex[0][n] + tb->ex[0][k];
+            const int sb = tb->ex[1][n] + tb->ex[1][k];
+            const int sc = tb->ex[2][n] + tb->ex[2][k];
+            const int deg = sa + sb + sc;
+            const double cb = binom(sa, tb->ex[0][k]) * binom(sb, tb->ex[1][k]) * binom(sc, tb->ex[2][k]);
+            if (deg > order) continue;
+            const int s = tb->idx_of[sa][sb][sc];
+            //M2M: M[n + k] += C(n + k, k) M'[k] d^n
+            add_term(&tb->m2m, &tb->nm2m, &cap_m2m, s, k, n, cb);
+            //L2L: L'[k] += C(n + k, k) L[n + k] e^n
+            add_term(&tb->l2l, &tb->nl2l, &cap_l2l, k, s, n, cb);
+        }
+    }
+}
+
+/* d^n を全ての n について求める */
+static void powers(const fmm *f, const double d[3], double *pw)
+{
+    const fmm_tables *tb = &f->tab;
+    double p[3][FMM_MAX_ORDER + 1];
+    for (int k = 0; k < 3; k++) {
+        p[k][0] = 1.0;
+        for (int e = 1; e <= f->order; e++) {
+            p[k][e] = p[k][e - 1] * d[k];
+        }
+    }
+    for (int n = 0; n < f->ncoef; n++) {
+        pw[n] = p[0][tb->ex[0][n]] * p[1][tb->ex[1][n]] * p[2][tb->ex[2][n]];
+    }
+}
+
+/* 初期化・解放 ************************************************************/
+void fmm_init(fmm *f, int order)
+{
+    if (order < 1) order = 1;
+    if (order > FMM_MAX_ORDER) order = FMM_MAX_ORDER;
+    f->order = order;
+    f->ncoef = (order + 1) * (order + 2) * (order + 3) / 6;
+    f->tab.order = -1;
+    f->tab.m2m = f->tab.m2l = f->tab.l2l = NULL;
+    f->tab.nm2m = f->tab.nm2l = f->tab.nl2l = 0;
+    bh_init(&f->tree);
+    f->tree.leaf_max = LEAF_SIZE;
+    f->M = f->L = f->rad = NULL;
+    f->begin = f->end = NULL;
+    f->cap = 0;
+    f->order_of = NULL;
+    bodies_init(&f->s);
+    f->ax = f->ay = f->az = NULL;
+    f->acc_cap = 0;
+    f->frontier = NULL;
+    f->nfrontier = f->frontier_cap = 0;
+    f->ninteract = 0;
+}
+
+void fmm_free(fmm *f)
+{
+    free(f->tab.m2m);
+    free(f->tab.m2l);
+    free(f->tab.l2l);
+    bh_free(&f->tree);
+    free(f->M);
+    free(f->L);
+    free(f->rad);
+    free(f->begin);
+    free(f->end);
+    free(f->order_of);
+    bodies_free(&f->s);
+    free(f->ax);
+    free(f->frontier);
+    fmm_init(f, f->order);
+}
+
+static void *grow(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (p == NULL) {
+        fprintf(stderr, "error: cannot allocate fmm.\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* 節点ndの星を深さ優先の順に並べ、範囲を記録する。葉の端数は-1(質量0の星)で埋める */
+static int arrange(fmm *f, int nd, int k)
+{
+    const bh_node *p = &f->tree.node[nd];
+    f->begin[nd] = k;
+    if (p->leaf) {
+        for (int j = p->first; j >= 0; j = f->tree.next[j]) {
+            f->order_of[k++] = j;
+        }
+        while (k % BODIES_PAD != 0) {
+            f->order_of[k++] = -1;
+        }
+    } else {
+        for (int c = 0; c < 8; c++) {
+            if (p->child[c] >= 0) k = arrange(f, p->child[c], k);
+        }
+    }
+    f->end[nd] = k;
+    return k;
+}
+
+/* 一つのスレッドが木をたどるときの状態 */
+typedef struct {
+    fmm *f;
+    double theta, eps2;
+    long count;             //相互作用の数
+    int npair;              //溜めてあるM2Lの組の数
+    int pa[M2L_BATCH], pb[M2L_BATCH]; //受け手と相手の節点
+} walker;
+
+/* 節点Bの星から節点Aの星への直接計算 */
+static void p2p(walker *w, int A, int B)
+{
+    fmm *f = w->f;
+    direct_accel_add(&f->s, f->begin[B], f->end[B], &f->s, f->begin[A], f->end[A],
+                     w->eps2, f->ax, f->ay, f->az);
+    w->count += (long) f->tree.node[A].count * f->tree.node[B].count;
+}
+
+/*
+ * M2Lの本体 **************************************************************
+ * M2L_BATCH個の組を並べ、組ごとの値をレーンとして同時に計算する。
+ * 係数の番号の表はどの組でも同じなので、内側のレーンのループはそのままベクトル化できる。
+ * 1/|R| のテイラー係数 T[n] = ∂^n (1/|R|) / n! は漸化式
+ *   |n| r^2 T[n] = -(2|n| - 1) Σ R_i T[n - e_i] - (|n| - 1) Σ T[n - 2e_i]
+ * で求める。r^2 = |R|^2 + eps^2 とすれば、ソフトニングした 1/sqrt(|R|^2 + eps^2) の係数になる。
+ */
+static inline __attribute__((always_inline))
+void m2l_lanes(fmm *f, const walker *w)
+{
+    const fmm_tables *tb = &f->tab;
+    const int ncoef = f->ncoef;
+    double R[3][M2L_BATCH], inv[M2L_BATCH];
+    double T[FMM_NCOEF_MAX][M2L_BATCH], M[FMM_NCOEF_MAX][M2L_BATCH];
+    int k, l, t;
+
+    //空いたレーンは遠くに置いた質量0の節点として計算する
+    for (l = 0; l < M2L_BATCH; l++) {
+        if (l < w->npair) {
+            const bh_node *a = &f->tree.node[w->pa[l]];
+            const bh_node *b = &f->tree.node[w->pb[l]];
+            const double *Mb = &f->M[(size_t) w->pb[l] * (size_t) ncoef];
+            for (k = 0; k < 3; k++) {
+                R[k][l] = a->com[k] - b->com[k];
+            }
+            for (k = 0; k < ncoef; k++) {
+                M[k][l] = Mb[k];
+            }
+        } else {
+            R[0][l] = 1.0;
+            R[1][l] = R[2][l] = 0.0;
+            for (k = 0; k < ncoef; k++) {
+                M[k][l] = 0.0;
+            }
+        }
+        const double r2 = R[0][l] * R[0][l] + R[1][l] * R[1][l] + R[2][l] * R[2][l] + w->eps2;
+        inv[l] = 1.0 / r2;
+        T[0][l] = sqrt(inv[l]);
+    }
+
+    for (int n = 1; n < ncoef; n++) {
+        const fmm_recur *q = &tb->rec[n];
+        double s1[M2L_BATCH], s2[M2L_BATCH];
+        for (l = 0; l < M2L_BATCH; l++) {
+            s1[l] = s2[l] = 0.0;
+        }
+        for (int i = 0; i < q->n1; i++) {
+            const double *Rd = R[q->dir1[i]], *Ti = T[q->idx1[i]];
+            for (l = 0; l < M2L_BATCH; l++) {
+                s1[l] += Rd[l] * Ti[l];
+            }
+        }
+        for (int i = 0; i < q->n2; i++) {
+            const double *Ti = T[q->idx2[i]];
+            for (l = 0; l < M2L_BATCH; l++) {
+                s2[l] += Ti[l];
+            }
+        }
+        for (l = 0; l < M2L_BATCH; l++) {
+            T[n][l] = -(q->c1 * s1[l] + q->c2 * s2[l]) * inv[l];
+        }
+    }
+
+    //L[k] += Σ (-1)^|n| C(n + k, n) M[n] T[n + k]
+    for (k = 0; k < ncoef; k++) {
+        double sum[M2L_BATCH];
+        for (l = 0; l < M2L_BATCH; l++) {
+            sum[l] = 0.0;
+        }
+        for (t = tb->m2l_start[k]; t < tb->m2l_start[k + 1]; t++) {
+            const double c = tb->m2l[t].c;
+            const double *Mi = M[tb->m2l[t].i], *Tx = T[tb->m2l[t].x];
+            for (l = 0; l < M2L_BATCH; l++) {
+                sum[l] += c * Mi[l] * Tx[l];
+            }
+        }
+        for (l = 0; l < w->npair; l++) {
+            f->L[(size_t) w->pa[l] * (size_t) ncoef + (size_t) k] += sum[l];
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void m2l_avx512(fmm *f, const walker *w)
+{
+    m2l_lanes(f, w);
+}
+
+__attribute__((target("avx2,fma")))
+static void m2l_avx2(fmm *f, const walker *w)
+{
+    m2l_lanes(f, w);
+}
+
+static void m2l_generic(fmm *f, const walker *w)
+{
+    m2l_lanes(f, w);
+}
+
+/* 溜めてあるM2Lを計算する。命令セットは直接計算と同じものを使う */
+static void m2l_flush(walker *w)
+{
+    if (w->npair == 0) return;
+    switch (direct_get_simd()) {
+    case SIMD_AVX512:
+        m2l_avx512(w->f, w);
+        break;
+    case SIMD_AVX2:
+        m2l_avx2(w->f, w);
+        break;
+    default:
+        m2l_generic(w->f, w);
+        break;
+    }
+    w->count += w->npair;
+    w->npair = 0;
+}
+
+/* 節点Bの多重極展開を節点Aの局所展開に足す組を溜める */
+static void m2l_add(walker *w, int A, int B)
+{
+    w->pa[w->npair] = A;
+    w->pb[w->npair] = B;
+    if (++w->npair == M2L_BATCH) m2l_flush(w);
+}
+
+/*
+ * 二重の木探索 ************************************************************
+ * 節点Bの星から節点Aの星への寄与を、Aの局所展開かAの星の加速度に足す。
+ * 書き込むのはAの側だけなので、互いに重ならないAについては並列に呼べる。
+ * BがAを含んでいても(根から始めても)、重なった節点は開き角の判定を通らないので正しく分けられる。
+ */
+static void interact(walker *w, int A, int B)
+{
+    fmm *f = w->f;
+    const bh_node *a = &f->tree.node[A];
+    const bh_node *b = &f->tree.node[B];
+    const long na = f->end[A] - f->begin[A];
+    const long nb = f->end[B] - f->begin[B];
+
+    if (A == B) {
+        if (a->leaf || na * nb <= P2P_MAX) {
+            p2p(w, A, A);
+            return;
+        }
+        for (int i = 0; i < 8; i++) {
+            if (a->child[i] < 0) continue;
+            for (int j = 0; j < 8; j++) {
+                if (a->child[j] < 0) continue;
+                interact(w, a->child[i], a->child[j]);
+            }
+        }
+        return;
+    }
+
+    const double dx = a->com[0] - b->com[0];
+    const double dy = a->com[1] - b->com[1];
+    const double dz = a->com[2] - b->com[2];
+    const double sep = f->rad[A] + f->rad[B];
+    if (sep * sep < w->theta * w->theta * (dx * dx + dy * dy + dz * dz) && na * nb > M2L_MIN) {
+        m2l_add(w, A, B);
+        return;
+    }
+    if ((a->leaf && b->leaf) || na * nb <= P2P_MAX) {
+        p2p(w, A, B);
+        return;
+    }
+    if (!a->leaf && (b->leaf || f->rad[A] >= f->rad[B])) {
+        for (int i = 0; i < 8; i++) {
+            if (a->child[i] >= 0) interact(w, a->child[i], B);
+        }
+    } else {
+        for (int j = 0; j < 8; j++) {
+            if (b->child[j] >= 0) interact(w, A, b->child[j]);
+        }
+    }
+}
+
+/* 下向き: 親の局所展開を子に移し(L2L)、葉で星の加速度に直す(L2P) *********/
+static void downward(fmm *f, int nd)
+{
+    const fmm_tables *tb = &f->tab;
+    const int ncoef = f->ncoef;
+    double pw[FMM_NCOEF_MAX];
+    const bh_node *p = &f->tree.node[nd];
+    const double *L = &f->L[(size_t) nd * (size_t) ncoef];
+
+    if (!p->leaf) {
+        for (int c = 0; c < 8; c++) {
+            if (p->child[c] < 0) continue;
+            const int ch = p->child[c];
+            double *Lc = &f->L[(size_t) ch * (size_t) ncoef];
+            const double e[3] = {f->tree.node[ch].com[0] - p->com[0],
+                                 f->tree.node[ch].com[1] - p->com[1],
+                                 f->tree.node[ch].com[2] - p->com[2]};
+            powers(f, e, pw);
+            for (int t = 0; t < tb->nl2l; t++) {
+                Lc[tb->l2l[t].o] += tb->l2l[t].c * L[tb->l2l[t].i] * pw[tb->l2l[t].x];
+            }
+            downward(f, ch);
+        }
+        return;
+    }
+    for (int i = f->begin[nd]; i < f->end[nd]; i++) {
+        if (f->order_of[i] < 0) continue;
+        const double u[3] = {f->s.x[i] - p->com[0], f->s.y[i] - p->com[1], f->s.z[i] - p->com[2]};
+        powers(f, u, pw);
+        //∂Φ/∂u_d = Σ L[k] k_d u^(k - e_d)
+        for (int k = 1; k < ncoef; k++) {
+            const int e0 = tb->ex[0][k], e1 = tb->ex[1][k], e2 = tb->ex[2][k];
+            if (e0 > 0) f->ax[i] += L[k] * e0 * pw[tb->idx_of[e0 - 1][e1][e2]];
+            if (e1 > 0) f->ay[i] += L[k] * e1 * pw[tb->idx_of[e0][e1 - 1][e2]];
+            if (e2 > 0) f->az[i] += L[k] * e2 * pw[tb->idx_of[e0][e1][e2 - 1]];
+        }
+    }
+}
+
+/* 星の数がlimit以下になる一番上の節点を集める */
+static void find_frontier(fmm *f, int nd, int limit)
+{
+    const bh_node *p = &f->tree.node[nd];
+    if (p->leaf || p->count <= limit) {
+        if (f->nfrontier == f->frontier_cap) {
+            f->frontier_cap = f->frontier_cap ? f->frontier_cap * 2 : 256;
+            f->frontier = (int *) grow(f->frontier, sizeof(int) * (size_t) f->frontier_cap);
+        }
+        f->frontier[f->nfrontier++] = nd;
+        return;
+    }
+    for (int c = 0; c < 8; c++) {
+        if (p->child[c] >= 0) find_frontier(f, p->child[c], limit);
+    }
+}
+
+/* 部分木ごとの仕事 */
+typedef struct {
+    fmm *f;
+    double theta, eps2;
+    int counter;
+    long ninteract;
+} fmm_task;
+
+static void fmm_worker(void *arg, int tid, int nthreads)
+{
+    fmm_task *task = (fmm_task *) arg;
+    fmm *f = task->f;
+    walker w = {f, task->theta, task->eps2, 0, 0, {0}, {0}};
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, f->nfrontier, 1, &begin, &end)) {
+        const int nd = f->frontier[begin];
+        interact(&w, nd, 0);
+        m2l_flush(&w);
+        downward(f, nd);
+    }
+    __atomic_fetch_add(&task->ninteract, w.count, __ATOMIC_RELAXED);
+}
+
+/* 加速度計算 **************************************************************/
+void fmm_accel(fmm *f, int n, const double *m, const double (*r)[3],
+               double theta, double eps, double (*a)[3])
+{
+    const fmm_tables *tb = &f->tab;
+    const int ncoef = f->ncoef;
+    int i, k, nd;
+
+    make_tables(f);
+    f->ninteract = 0;
+    for (i = 0; i < n; i++) {
+        a[i][0] = a[i][1] = a[i][2] = 0.0;
+    }
+
+    bh_build(&f->tree, n, m, r);
+    const int nnode = f->tree.nnode;
+    if (nnode == 0) return;
+
+    if (nnode > f->cap) {
+        f->cap = nnode;
+        f->M = (double *) grow(f->M, sizeof(double) * (size_t) nnode * (size_t) ncoef);
+        f->L = (double *) grow(f->L, sizeof(double) * (size_t) nnode * (size_t) ncoef);
+        f->rad = (double *) grow(f->rad, sizeof(double) * (size_t) nnode);
+        f->begin = (int *) grow(f->begin, sizeof(int) * (size_t) nnode);
+        f->end = (int *) grow(f->end, sizeof(int) * (size_t) nnode);
+    }
+    //葉ごとに端数を埋めるので、星の数は最大で葉の数 x (BODIES_PAD - 1) だけ増える
+    const int nslot = bodies_padded(n + nnode * (BODIES_PAD - 1));
+    if (nslot > f->acc_cap) {
+        void *q;
+        f->acc_cap = nslot;
+        f->order_of = (int *) grow(f->order_of, sizeof(int) * (size_t) nslot);
+        free(f->ax);
+        if (posix_memalign(&q, 64, sizeof(double) * 3 * (size_t) nslot) != 0) {
+            fprintf(stderr, "error: cannot allocate fmm.\n");
+            exit(1);
+        }
+        f->ax = (double *) q;
+        f->ay = f->ax + nslot;
+        f->az = f->ay + nslot;
+    }
+
+    //星を木の順に並べ替えて、節点ごとに連続した範囲にする
+    //埋めた星は質量0にして、葉の重心に置く
+    const int nslot_used = arrange(f, 0, 0);
+    bodies_resize(&f->s, nslot_used);
+    for (nd = 0; nd < nnode; nd++) {
+        const bh_node *p = &f->tree.node[nd];
+        if (!p->leaf) continue;
+        for (i = f->begin[nd]; i < f->end[nd]; i++) {
+            const int j = f->order_of[i];
+            f->s.x[i] = j < 0 ? p->com[0] : r[j][0];
+            f->s.y[i] = j < 0 ? p->com[1] : r[j][1];
+            f->s.z[i] = j < 0 ? p->com[2] : r[j][2];
+            f->s.m[i] = j < 0 ? 0.0 : m[j];
+        }
+    }
+    memset(f->ax, 0, sizeof(double) * 3 * (size_t) f->acc_cap);
+
+    //上向き: 葉は星から(P2M)、それ以外は子から(M2M)多重極展開を作る
+    double pw[FMM_NCOEF_MAX];
+    for (nd = nnode - 1; nd >= 0; nd--) {
+        const bh_node *p = &f->tree.node[nd];
+        double *M = &f->M[(size_t) nd * (size_t) ncoef];
+        double rad = 0.0;
+        memset(M, 0, sizeof(double) * (size_t) ncoef);
+        memset(&f->L[(size_t) nd * (size_t) ncoef], 0, sizeof(double) * (size_t) ncoef);
+        if (p->leaf) {
+            for (i = f->begin[nd]; i < f->end[nd]; i++) {
+                if (f->order_of[i] < 0) continue;
+                const double y[3] = {f->s.x[i] - p->com[0], f->s.y[i] - p->com[1], f->s.z[i] - p->com[2]};
+                powers(f, y, pw);
+                for (k = 0; k < ncoef; k++) {
+                    M[k] += f->s.m[i] * pw[k];
+                }
+                const double d = sqrt(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]);
+                if (d > rad) rad = d;
+            }
+        } else {
+            for (int c = 0; c < 8; c++) {
+                if (p->child[c] < 0) continue;
+                const int ch = p->child[c];
+                const double *Mc = &f->M[(size_t) ch * (size_t) ncoef];
+                const double d[3] = {f->tree.node[ch].com[0] - p->com[0],
+                                     f->tree.node[ch].com[1] - p->com[1],
+                                     f->tree.node[ch].com[2] - p->com[2]};
+                powers(f, d, pw);
+                for (int t = 0; t < tb->nm2m; t++) {
+                    M[tb->m2m[t].o] += tb->m2m[t].c * Mc[tb->m2m[t].i] * pw[tb->m2m[t].x];
+                }
+                const double dd = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + f->rad[ch];
+                if (dd > rad) rad = dd;
+            }
+        }
+        f->rad[nd] = rad;
+    }
+
+    //互いに重ならない部分木に分け、それぞれを受け手として根と相互作用させる
+    f->nfrontier = 0;
+    int limit = nslot_used / NTASK;
+    if (limit < LEAF_SIZE) limit = LEAF_SIZE;
+    find_frontier(f, 0, limit);
+
+    fmm_task task = {f, theta, eps * eps, 0, 0};
+    pool_run(fmm_worker, &task);
+    f->ninteract = task.ninteract;
+
+    for (i = 0; i < nslot_used; i++) {
+        const int j = f->order_of[i];
+        if (j < 0) continue;
+        a[j][0] = f->ax[i];
+        a[j][1] = f->ay[i];
+        a[j][2] = f->az[i];
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef FMM_H
+#define FMM_H
+
+#include "bhtree.h"
+#include "bodies.h"
+
+/*
+ * 高速多重極展開法(FMM)
+ * 八分木の各節点で、重心のまわりのデカルト座標のテイラー展開(order次まで)を使う。
+ * 多重極展開(M)を下から集め、十分離れた節点の組は M2L で局所展開(L)に変換し、
+ * 近い組だけ直接計算する。節点の組は二重の木探索で選ぶので、全体で O(N) になる。
+ * 誤差はおおよそ theta^(order + 1) で小さくなる。
+ * 受け手の側を互いに重ならない部分木に分けて、スレッドプールで並列に計算する。
+ * 近い組は direct_accel_add の SIMD カーネルで計算し、M2L は8組ずつまとめてベクトル化する。
+ * ソフトニングは M2L の展開にも入れる(1/sqrt(r^2 + eps^2) を展開する)。
+ */
+
+#define FMM_MAX_ORDER 10
+#define FMM_NCOEF_MAX ((FMM_MAX_ORDER + 1) * (FMM_MAX_ORDER + 2) * (FMM_MAX_ORDER + 3) / 6)
+
+/* 係数同士の積和 out[o] += c * in[i] * aux[x] の一項 */
+typedef struct {
+    int o, i, x;
+    double c;
+} fmm_term;
+
+/* テイラー係数の漸化式で使う、一つ低い次数と二つ低い次数の係数の番号 */
+typedef struct {
+    int n1, n2;        //n1, n2個
+    int dir1[3], idx1[3]; //R[dir1] * T[idx1] を足す
+    int idx2[3];       //T[idx2] を足す
+    double c1, c2;     //(2|n| - 1) / |n|, (|n| - 1) / |n|
+} fmm_recur;
+
+/*
+ * 展開の次数だけで決まる表。fmm_accelの最初の呼び出しで作る。
+ * fmmごとに持つので、別々のfmmなら別のスレッドから同時に計算してよい。
+ */
+typedef struct {
+    int order;  //表を作った次数(まだ作っていなければ-1)
+    int ex[3][FMM_NCOEF_MAX]; //番号nの係数の多重指数
+    int idx_of[FMM_MAX_ORDER + 1][FMM_MAX_ORDER + 1][FMM_MAX_ORDER + 1]; //多重指数から番号
+    fmm_term *m2m, *m2l, *l2l;
+    int nm2m, nm2l, nl2l;
+    int m2l_start[FMM_NCOEF_MAX + 1]; //m2lのうち出力がkの項は [m2l_start[k], m2l_start[k + 1])
+    fmm_recur rec[FMM_NCOEF_MAX];
+} fmm_tables;
+
+typedef struct {
+    int order;  //展開の次数
+    int ncoef;  //係数の数 (order + 1)(order + 2)(order + 3) / 6
+    fmm_tables tab;
+    bhtree tree;
+    double *M;  //節点ごとの多重極展開 (nnode x ncoef)
+    double *L;  //節点ごとの局所展開 (nnode x ncoef)
+    double *rad; //節点の重心から最も遠い星までの距離
+    int *begin, *end; //節点が受け持つ星の範囲(並べ替えた後の番号)
+    int cap;    //節点ごとの配列の大きさ
+    int *order_of; //並べ替えた後の i 番目の星の元の番号
+    bodies s;       //並べ替えた星(葉ごとにBODIES_PADの倍数にそろえ、余りは質量0の星で埋める)
+    double *ax, *ay, *az; //並べ替えた星の加速度(64バイト境界にそろえる)
+    int acc_cap;    //order_of, ax, ay, az の長さ
+    int *frontier;  //スレッドに配る部分木の根
+    int nfrontier, frontier_cap;
+    long ninteract; //直前の計算での相互作用の数(粒子対とM2Lを一つずつ数える)
+} fmm;
+
+void fmm_init(fmm *f, int order);
+void fmm_free(fmm *f);
+
+/* 全ての星の加速度(G = 1)を求める */
+void fmm_accel(fmm *f, int n, const double *m, const double (*r)[3],
+               double theta, double eps, double (*a)[3]);
+
+#endif
@@ -0,0 +1,655 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "force.h"
+#include "direct.h"
+#include "pool.h"
+
+#define FMM_SUBSET 4 //FMMで求める星が全体の1/FMM_SUBSET未満なら、Barnes-Hut木で求める星だけを計算する
+
+/* 初期化 ******************************************************************/
+static void ctx_init(force_ctx *c)
+{
+    bh_init(&c->tree);
+    c->fmm_ready = 0;
+    c->pm_ready = 0;
+    bodies_init(&c->soa);
+    bodies_init(&c->targets);
+    bodies_f_init(&c->soa_f);
+    bodies_f_init(&c->targets_f);
+    c->sax = c->say = c->saz = NULL;
+    c->soa_cap = 0;
+    c->sym_buf = NULL;
+    c->sym_cap = 0;
+    c->fmm_all = NULL;
+    c->fmm_all_cap = 0;
+    memset(&c->count, 0, sizeof(c->count));
+}
+
+void force_init(force_param *p, double G, force_ctx *ctx)
+{
+    p->solver = SOLVER_DIRECT;
+    p->G = G;
+    p->theta = 0.5;
+    p->eps = 0.0;
+    p->order = 4;
+    p->symmetric = 0;
+    p->mixed = 0;
+    p->grid = 64;
+    p->box = 100.0;
+    p->ctx = ctx;
+    ctx_init(ctx);
+
+    //直接計算の命令セットはスレッドから読むだけなので、ここで決めておく(-Sで選んだものは変えない)
+    if (direct_get_simd() == SIMD_AUTO) {
+        direct_set_simd(SIMD_AUTO);
+    }
+}
+
+void force_ctx_free(force_ctx *c)
+{
+    bh_free(&c->tree);
+    if (c->fmm_ready) fmm_free(&c->fmm_work);
+    if (c->pm_ready) pm_free(&c->pm_work);
+    bodies_free(&c->soa);
+    bodies_free(&c->targets);
+    bodies_f_free(&c->soa_f);
+    bodies_f_free(&c->targets_f);
+    free(c->sax);
+    free(c->say);
+    free(c->saz);
+    free(c->sym_buf);
+    free(c->fmm_all);
+    ctx_init(c);
+}
+
+/* 解法の名前 **************************************************************/
+int force_parse_solver(const char *name)
+{
+    if (strcmp(name, "direct") == 0) return SOLVER_DIRECT;
+    if (strcmp(name, "bh") == 0) return SOLVER_BH;
+    if (strcmp(name, "fmm") == 0) return SOLVER_FMM;
+    if (strcmp(name, "pm") == 0) return SOLVER_PM;
+    return -1;
+}
+
+const char *force_solver_name(solver_type s)
+{
+    switch (s) {
+    case SOLVER_DIRECT: return "direct";
+    case SOLVER_BH: return "bh";
+    case SOLVER_FMM: return "fmm";
+    case SOLVER_PM: return "pm";
+    }
+    return "unknown";
+}
+
+/* 星iの加速度を直接計算する(G = 1) ****************************************/
+static void direct_one(int n, const double *m, const double (*r)[3], int i,
+                       double eps2, double a[3])
+{
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    for (int j = 0; j < n; j++) {
+        if (m[j] == 0 || i == j) continue;
+        const double dx = r[j][0] - r[i][0];
+        const double dy = r[j][1] - r[i][1];
+        const double dz = r[j][2] - r[i][2];
+        const double d2 = dx * dx + dy * dy + dz * dz + eps2;
+        const double inv = m[j] / (d2 * sqrt(d2));
+        ax += dx * inv;
+        ay += dy * inv;
+        az += dz * inv;
+    }
+    a[0] = ax;
+    a[1] = ay;
+    a[2] = az;
+}
+
+/* 直接計算の仕事: 星を512個ずつ取り出して計算する */
+typedef struct {
+    force_ctx *ctx;
+    const bodies *targets; //加速度を求める点
+    int n;
+    double eps2;
+    int counter;
+} direct_task;
+
+static void direct_worker(void *arg, int tid, int nthreads)
+{
+    direct_task *task = (direct_task *) arg;
+    force_ctx *c = task->ctx;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->n, 512, &begin, &end)) {
+        direct_accel_at(&c->soa, task->targets, begin, end, task->eps2, c->sax, c->say, c->saz);
+    }
+}
+
+/* 混合精度の直接計算の仕事 */
+typedef struct {
+    force_ctx *ctx;
+    const bodies_f *targets;
+    int n;
+    float eps2;
+    int counter;
+} mixed_task;
+
+static void mixed_worker(void *arg, int tid, int nthreads)
+{
+    mixed_task *task = (mixed_task *) arg;
+    force_ctx *c = task->ctx;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->n, 512, &begin, &end)) {
+        direct_accel_mixed(&c->soa_f, task->targets, begin, end, task->eps2, c->sax, c->say, c->saz);
+    }
+}
+
+/*
+ * 混合精度で計算する
+ * 単精度に丸める前に、生きている星を囲む箱の中心を原点にする(原点から遠い星団でも
+ * 座標の桁を無駄にしないため)。差を取る前に丸めるので、近い星どうしの相対位置の誤差は
+ * 箱の大きさ x 6e-8 程度になる。
+ */
+static void run_mixed(const force_param *p, int n, const double *m, int nactive, const int *active)
+{
+    force_ctx *c = p->ctx;
+    double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+    double hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    double origin[3] = {0.0, 0.0, 0.0};
+    int i, k;
+
+    for (i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        const double q[3] = {c->soa.x[i], c->soa.y[i], c->soa.z[i]};
+        for (k = 0; k < 3; k++) {
+            if (q[k] < lo[k]) lo[k] = q[k];
+            if (q[k] > hi[k]) hi[k] = q[k];
+        }
+    }
+    if (lo[0] <= hi[0]) {
+        for (k = 0; k < 3; k++) origin[k] = (lo[k] + hi[k]) / 2;
+    }
+
+    bodies_f_from(&c->soa_f, &c->soa, origin);
+    const float eps2 = (float) (p->eps * p->eps);
+    if (active == NULL) {
+        mixed_task task = {c, &c->soa_f, n, eps2, 0};
+        pool_run(mixed_worker, &task);
+    } else {
+        bodies_f_from(&c->targets_f, &c->targets, origin);
+        mixed_task task = {c, &c->targets_f, nactive, eps2, 0};
+        pool_run(mixed_worker, &task);
+    }
+}
+
+/*
+ * 作用反作用を使う直接計算の仕事
+ * ブロックの組はスレッドの番号で順番に割り当てるので、スレッドの数が同じなら
+ * 足し合わせる順序も同じになり、毎回同じ結果になる。
+ */
+typedef struct {
+    force_ctx *ctx;
+    int n;
+    int npad;
+    double eps2;
+    int counter;
+} sym_task;
+
+static void sym_worker(void *arg, int tid, int nthreads)
+{
+    sym_task *task = (sym_task *) arg;
+    force_ctx *c = task->ctx;
+    double *ax = c->sym_buf + (size_t) tid * 3 * task->npad;
+    double *ay = ax + task->npad;
+    double *az = ay + task->npad;
+    const int count = direct_pair_count(&c->soa);
+
+    memset(ax, 0, sizeof(double) * 3 * (size_t) task->npad);
+    for (int t = tid; t < count; t += nthreads) {
+        direct_pair(&c->soa, t, task->eps2, ax, ay, az);
+    }
+}
+
+/* スレッドごとの加速度を足し合わせる(星の範囲を分けて並列に行う) */
+static void sym_reduce(void *arg, int tid, int nthreads)
+{
+    sym_task *task = (sym_task *) arg;
+    force_ctx *c = task->ctx;
+    const size_t stride = 3 * (size_t) task->npad;
+    int begin, end;
+    (void) tid;
+    while (pool_next(&task->counter, task->n, 1024, &begin, &end)) {
+        for (int i = begin; i < end; i++) {
+            double x = 0.0, y = 0.0, z = 0.0;
+            for (int k = 0; k < nthreads; k++) {
+                const double *buf = c->sym_buf + k * stride;
+                x += buf[i];
+                y += buf[task->npad + i];
+                z += buf[2 * task->npad + i];
+            }
+            c->sax[i] = x;
+            c->say[i] = y;
+            c->saz[i] = z;
+        }
+    }
+}
+
+static void run_symmetric(const force_param *p, int n)
+{
+    force_ctx *c = p->ctx;
+    const int npad = bodies_padded(n);
+    const size_t need = (size_t) pool_size() * 3 * (size_t) npad;
+    if (need > c->sym_cap) {
+        void *q;
+        free(c->sym_buf);
+        if (posix_memalign(&q, 64, sizeof(double) * need) != 0) {
+            fprintf(stderr, "error: cannot allocate accelerations.\n");
+            exit(1);
+        }
+        c->sym_buf = (double *) q;
+        c->sym_cap = need;
+    }
+    sym_task task = {c, n, npad, p->eps * p->eps, 0};
+    pool_run(sym_worker, &task);
+    pool_run(sym_reduce, &task);
+}
+
+/*
+ * 成分ごとの配列に並べ替えて、SIMDで直接計算する
+ * activeがNULLでなければ、active[0..nactive-1]番目の星の加速度だけを求める。
+ */
+static void run_direct(const force_param *p, int n, const double *m,
+                       const double (*r)[3], int nactive, const int *active,
+                       double (*a)[3])
+{
+    force_ctx *c = p->ctx;
+    int i, k;
+
+    bodies_resize(&c->soa, n);
+    if (n > c->soa_cap) {
+        c->soa_cap = n;
+        c->sax = (double *) realloc(c->sax, sizeof(double) * (size_t) n);
+        c->say = (double *) realloc(c->say, sizeof(double) * (size_t) n);
+        c->saz = (double *) realloc(c->saz, sizeof(double) * (size_t) n);
+        if (c->sax == NULL || c->say == NULL || c->saz == NULL) {
+            fprintf(stderr, "error: cannot allocate accelerations.\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < n; i++) {
+        c->soa.x[i] = r[i][0];
+        c->soa.y[i] = r[i][1];
+        c->soa.z[i] = r[i][2];
+        c->soa.m[i] = m[i];
+    }
+
+    if (active != NULL) {
+        //求める星の座標だけを集める(作用反作用は一部の星には使えない)
+        bodies_resize(&c->targets, nactive);
+        for (k = 0; k < nactive; k++) {
+            c->targets.x[k] = r[active[k]][0];
+            c->targets.y[k] = r[active[k]][1];
+            c->targets.z[k] = r[active[k]][2];
+        }
+    }
+
+    if (p->mixed) {
+        run_mixed(p, n, m, nactive, active);
+    } else if (active == NULL) {
+        if (p->symmetric) {
+            run_symmetric(p, n);
+        } else {
+            direct_task task = {c, &c->soa, n, p->eps * p->eps, 0};
+            pool_run(direct_worker, &task);
+        }
+    } else {
+        direct_task task = {c, &c->targets, nactive, p->eps * p->eps, 0};
+        pool_run(direct_worker, &task);
+    }
+
+    const int count = active == NULL ? n : nactive;
+    for (k = 0; k < count; k++) {
+        i = active == NULL ? k : active[k];
+        if (m[i] == 0) {
+            a[i][0] = a[i][1] = a[i][2] = 0.0;
+            continue;
+        }
+        a[i][0] = c->sax[k] * p->G;
+        a[i][1] = c->say[k] * p->G;
+        a[i][2] = c->saz[k] * p->G;
+    }
+}
+
+/* 八分木の仕事: 星を256個ずつ取り出して木をたどる */
+typedef struct {
+    const force_param *p;
+    int n;
+    const int *active; //NULLなら全ての星
+    const double *m;
+    const double (*r)[3];
+    double (*a)[3];
+    int counter;
+    long ninteract; //木をたどったときの相互作用の数
+} bh_task;
+
+static void bh_worker(void *arg, int tid, int nthreads)
+{
+    bh_task *task = (bh_task *) arg;
+    const force_param *p = task->p;
+    long ninteract = 0;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->n, 256, &begin, &end)) {
+        for (int k = begin; k < end; k++) {
+            const int i = task->active == NULL ? k : task->active[k];
+            double *a = task->a[i];
+            if (task->m[i] == 0) {
+                a[0] = a[1] = a[2] = 0.0;
+                continue;
+            }
+            ninteract += bh_accel(&p->ctx->tree, task->r[i], i, p->theta, p->eps, a);
+            for (int c = 0; c < 3; c++) {
+                a[c] *= p->G;
+            }
+        }
+    }
+    __atomic_fetch_add(&task->ninteract, ninteract, __ATOMIC_RELAXED);
+}
+
+/* 八分木をたどって計算する(木を作るのは一つのスレッドで行う)。相互作用の数を返す */
+static long run_bh(const force_param *p, int n, const double *m,
+                   const double (*r)[3], int nactive, const int *active,
+                   double (*a)[3])
+{
+    bh_build(&p->ctx->tree, n, m, r);
+    bh_task task = {p, active == NULL ? n : nactive, active, m, r, a, 0, 0};
+    pool_run(bh_worker, &task);
+    return task.ninteract;
+}
+
+/* 多重極展開で計算する(G = 1 のまま返す) */
+static void fmm_raw(const force_param *p, int n, const double *m,
+                    const double (*r)[3], double (*a)[3])
+{
+    force_ctx *c = p->ctx;
+    if (!c->fmm_ready || c->fmm_work.order != p->order) {
+        if (c->fmm_ready) fmm_free(&c->fmm_work);
+        fmm_init(&c->fmm_work, p->order);
+        c->fmm_ready = 1;
+    }
+    fmm_accel(&c->fmm_work, n, m, r, p->theta, p->eps, a);
+}
+
+/*
+ * FMMは木全体で計算するので、一部の星だけのときも全体を求めてから取り出す。
+ * ブロック時間刻みの細かい段のように求める星が少ないときは、全体を解くと星の数に比べて
+ * 遅すぎるので、同じ開き角のBarnes-Hut木で求める星だけを計算する。相互作用の数を返す
+ */
+static long run_fmm(const force_param *p, int n, const double *m,
+                    const double (*r)[3], int nactive, const int *active,
+                    double (*a)[3])
+{
+    force_ctx *c = p->ctx;
+    int i, k;
+    double (*out)[3] = a;
+
+    if (active != NULL) {
+        if ((long) nactive * FMM_SUBSET < n) return run_bh(p, n, m, r, nactive, active, a);
+        if (n > c->fmm_all_cap) {
+            c->fmm_all = (double (*)[3]) realloc(c->fmm_all, sizeof(double) * 3 * (size_t) n);
+            if (c->fmm_all == NULL) {
+                fprintf(stderr, "error: cannot allocate accelerations.\n");
+                exit(1);
+            }
+            c->fmm_all_cap = n;
+        }
+        out = c->fmm_all;
+    }
+    fmm_raw(p, n, m, r, out);
+    const int count = active == NULL ? n : nactive;
+    for (k = 0; k < count; k++) {
+        i = active == NULL ? k : active[k];
+        for (int c = 0; c < 3; c++) {
+            a[i][c] = out[i][c] * p->G;
+        }
+    }
+    return c->fmm_work.ninteract;
+}
+
+/* 周期境界の格子で解く(格子は一つのスレッドで作り直し、解くのと補間は並列に行う) */
+static void prepare_pm(const force_param *p, int n, const double *m, const double (*r)[3])
+{
+    force_ctx *c = p->ctx;
+    if (!c->pm_ready || c->pm_work.ng != p->grid || c->pm_work.box != p->box) {
+        if (c->pm_ready) pm_free(&c->pm_work);
+        if (pm_init(&c->pm_work, p->grid, p->box) != 0) {
+            fprintf(stderr, "error: mesh size must be a power of two (>= 8) and box must be positive.\n");
+            exit(1);
+        }
+        c->pm_ready = 1;
+    }
+    pm_solve(&c->pm_work, n, m, r);
+}
+
+/* 星ごとの補間の仕事(仕事の形は八分木と同じ) */
+static void pm_worker(void *arg, int tid, int nthreads)
+{
+    bh_task *task = (bh_task *) arg;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->n, 1024, &begin, &end)) {
+        for (int k = begin; k < end; k++) {
+            const int i = task->active == NULL ? k : task->active[k];
+            double *a = task->a[i];
+            if (task->m[i] == 0) {
+                a[0] = a[1] = a[2] = 0.0;
+                continue;
+            }
+            pm_accel_at(&task->p->ctx->pm_work, task->r[i], a);
+            for (int c = 0; c < 3; c++) {
+                a[c] *= task->p->G;
+            }
+        }
+    }
+}
+
+static void run_pm(const force_param *p, int n, const double *m,
+                   const double (*r)[3], int nactive, const int *active,
+                   double (*a)[3])
+{
+    prepare_pm(p, n, m, r);
+    bh_task task = {p, active == NULL ? n : nactive, active, m, r, a, 0, 0};
+    pool_run(pm_worker, &task);
+}
+
+/* 加速度計算 **************************************************************/
+void force_accel(const force_param *p, int n, const double *m,
+                 const double (*r)[3], double (*a)[3])
+{
+    force_accel_active(p, n, m, r, n, NULL, a);
+}
+
+void force_accel_active(const force_param *p, int n, const double *m,
+                        const double (*r)[3], int nactive, const int *active,
+                        double (*a)[3])
+{
+    const int ntarget = active != NULL ? nactive : n;
+    const double others = n > 1 ? n - 1 : 0;
+    force_count *count = &p->ctx->count;
+    count->ncall++;
+    count->nbody += ntarget;
+    count->ndirect += ntarget * others;
+
+    switch (p->solver) {
+    case SOLVER_DIRECT:
+        run_direct(p, n, m, r, nactive, active, a);
+        //作用反作用を使うときは一つの組を一度だけ計算する
+        if (active == NULL && p->symmetric && !p->mixed) {
+            count->ninteract += n * others / 2;
+        } else {
+            count->ninteract += ntarget * others;
+        }
+        break;
+    case SOLVER_BH:
+        count->ninteract += run_bh(p, n, m, r, nactive, active, a);
+        break;
+    case SOLVER_FMM:
+        count->ninteract += run_fmm(p, n, m, r, nactive, active, a);
+        break;
+    case SOLVER_PM:
+        run_pm(p, n, m, r, nactive, active, a);
+        count->ncell += (double) p->grid * p->grid * p->grid;
+        break;
+    }
+}
+
+/* 位置エネルギー **********************************************************/
+typedef struct {
+    const force_param *p;
+    int n;
+    const double *m;
+    const double (*r)[3];
+    double *sum; //スレッドごとの和
+    int counter;
+} potential_task;
+
+static void potential_worker(void *arg, int tid, int nthreads)
+{
+    potential_task *task = (potential_task *) arg;
+    const force_param *p = task->p;
+    const double *m = task->m;
+    const double (*r)[3] = task->r;
+    const double eps2 = p->eps * p->eps;
+    double u = 0.0;
+    int begin, end;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->n, 64, &begin, &end)) {
+        for (int i = begin; i < end; i++) {
+            if (m[i] == 0) continue;
+            if (p->solver == SOLVER_PM) {
+                //格子のポテンシャルは全ての相手(と周期の像)と、自分自身の分も含む
+                u += 0.5 * m[i] * (pm_potential_at(&p->ctx->pm_work, r[i]) - m[i] * pm_self_potential(&p->ctx->pm_work, r[i]));
+                continue;
+            }
+            if (p->solver != SOLVER_DIRECT) {
+                //木のポテンシャルは全ての相手を含むので、半分にして二重に数えないようにする
+                u += 0.5 * m[i] * bh_potential(&p->ctx->tree, r[i], i, p->theta, p->eps);
+                continue;
+            }
+            for (int j = i + 1; j < task->n; j++) {
+                if (m[j] == 0) continue;
+                const double dx = r[j][0] - r[i][0];
+                const double dy = r[j][1] - r[i][1];
+                const double dz = r[j][2] - r[i][2];
+                u -= m[i] * m[j] / sqrt(dx * dx + dy * dy + dz * dz + eps2);
+            }
+        }
+    }
+    task->sum[tid] = u;
+}
+
+double force_potential(const force_param *p, int n, const double *m, const double (*r)[3])
+{
+    double u = 0.0;
+    double *sum = (double *) malloc(sizeof(double) * (size_t) pool_size());
+    if (sum == NULL) {
+        fprintf(stderr, "error: cannot allocate potential sums.\n");
+        exit(1);
+    }
+    if (p->solver == SOLVER_PM) {
+        prepare_pm(p, n, m, r);
+    } else if (p->solver != SOLVER_DIRECT) {
+        bh_build(&p->ctx->tree, n, m, r);
+    }
+    potential_task task = {p, n, m, r, sum, 0};
+    pool_run(potential_worker, &task);
+    for (int t = 0; t < pool_size(); t++) {
+        u += sum[t];
+    }
+    free(sum);
+    return p->G * u;
+}
+
+void force_get_count(const force_param *p, force_count *c)
+{
+    *c = p->ctx->count;
+}
+
+/* 近似の誤差 **************************************************************/
+void force_error(const force_param *p, int n, const double *m,
+                 const double (*r)[3], int nsample, double *rms, double *max)
+{
+    int i, nactive = 0, count = 0;
+    double sum = 0.0;
+
+    *rms = *max = 0.0;
+    if (p->solver == SOLVER_DIRECT && !p->mixed) return;
+    if (p->solver == SOLVER_PM) return; //周期境界の力は直接計算と比べられない
+
+    for (i = 0; i < n; i++) {
+        if (m[i] != 0) nactive++;
+    }
+    if (nactive == 0 || nsample <= 0) return;
+    const int stride = nactive > nsample ? nactive / nsample : 1;
+
+    //生きている星のうち、stride個おきに選んで比べる
+    int *sample = (int *) malloc(sizeof(int) * (size_t) nsample);
+    if (sample == NULL) return;
+    int nchosen = 0, seen = 0;
+    for (i = 0; i < n && nchosen < nsample; i++) {
+        if (m[i] == 0) continue;
+        if (seen++ % stride != 0) continue;
+        sample[nchosen++] = i;
+    }
+
+    //FMMは一部の星だけを計算できないので、全体を一度計算して比べる
+    //混合精度の直接計算は選んだ星だけを計算する(Gを掛けて返るので割って戻す)
+    double (*all)[3] = NULL;
+    if (p->solver != SOLVER_BH) {
+        all = (double (*)[3]) malloc(sizeof(double) * 3 * (size_t) n);
+        if (all == NULL) {
+            free(sample);
+            return;
+        }
+        if (p->solver == SOLVER_FMM) {
+            fmm_raw(p, n, m, r, all);
+        } else {
+            run_direct(p, n, m, r, nchosen, sample, all);
+            for (int s = 0; s < nchosen; s++) {
+                for (int k = 0; k < 3; k++) all[sample[s]][k] /= p->G;
+            }
+        }
+    } else {
+        bh_build(&p->ctx->tree, n, m, r);
+    }
+
+    for (int s = 0; s < nchosen; s++) {
+        i = sample[s];
+        double exact[3], approx[3];
+        direct_one(n, m, r, i, p->eps * p->eps, exact);
+        if (all != NULL) {
+            for (int k = 0; k < 3; k++) approx[k] = all[i][k];
+        } else {
+            bh_accel(&p->ctx->tree, r[i], i, p->theta, p->eps, approx);
+        }
+
+        const double e = sqrt((approx[0] - exact[0]) * (approx[0] - exact[0])
+                            + (approx[1] - exact[1]) * (approx[1] - exact[1])
+                            + (approx[2] - exact[2]) * (approx[2] - exact[2]));
+        const double norm = sqrt(exact[0] * exact[0] + exact[1] * exact[1] + exact[2] * exact[2]);
+        if (norm == 0) continue;
+        sum += (e / norm) * (e / norm);
+        if (e / norm > *max) *max = e / norm;
+        count++;
+    }
+    if (count > 0) *rms = sqrt(sum / count);
+    free(all);
+    free(sample);
+}
@@ -0,0 +1,113 @@
+#ifndef FORCE_H
+#define FORCE_H
+
+#include "bhtree.h"
+#include "fmm.h"
+#include "pm.h"
+#include "bodies.h"
+
+/*
+ * 重力による加速度の計算
+ * gravity3.c, gravity3_RK4.c から共通で使う。
+ * 座標と加速度はn x 3の配列で受け渡しする(3次元の vector と同じ並び)。
+ * 質量が0の星(融合して消えた星)は力を及ぼさず、加速度も0にする。
+ *
+ * 木や格子などの作業領域は force_ctx にまとめて持ち、force_param から指す。
+ * 別々の force_ctx を使えば、いくつの系でも同じプロセスの中で持てる。ただしスレッドプール
+ * (pool.c)と直接計算の命令セット(direct.c)はプロセスで一つなので、計算は一つのスレッドから順に呼ぶこと。
+ *
+ * コンパイル: gcc -O2 -pthread gravity3_RK4.c runner.c force.c bhtree.c fmm.c bodies.c direct.c pool.c blockstep.c integrator.c collide.c initcond.c snapshot.c asyncout.c diag.c checkpoint.c liveview.c nbody.c pm.c -lm
+ */
+
+typedef enum {
+    SOLVER_DIRECT, //全ての組について足し合わせる O(N^2)
+    SOLVER_BH,     //Barnes-Hut木 O(N log N)
+    SOLVER_FMM,    //高速多重極展開法 O(N)
+    SOLVER_PM      //周期境界のParticle-Mesh法 O(N + M log M)
+} solver_type;
+
+/* これまでに力を計算した量(実行の速さを測るため) */
+typedef struct {
+    long ncall;       //force_accel_activeを呼んだ回数
+    long long nbody;  //加速度を求めた星の数の合計
+    double ninteract; //実際に計算した相互作用の数(直接計算は組, Barnes-Hutは節点と星, FMMは粒子対とM2L)
+    double ncell;     //PMで解いた格子点の数の合計
+    double ndirect;   //求めた星 x 全体の星の数の合計(同じ計算を直接計算でしたときの組の数, 比べるための目安)
+} force_count;
+
+/* 力の計算の作業領域(毎回作り直すが、領域は使い回す) */
+typedef struct {
+    bhtree tree;
+    fmm fmm_work;
+    int fmm_ready; //fmm_workを次数fmm_work.orderで確保してあれば1
+    pm pm_work;
+    int pm_ready;  //pm_workを確保してあれば1
+    bodies soa;     //直接計算に使う成分ごとの配列
+    bodies targets; //一部の星だけを計算するときの、その星の座標
+    bodies_f soa_f, targets_f; //混合精度のときの単精度の座標
+    double *sax, *say, *saz;
+    int soa_cap;
+    double *sym_buf; //作用反作用を使うときのスレッドごとの加速度
+    size_t sym_cap;
+    double (*fmm_all)[3]; //FMMで一部の星だけを求めるときの全体の結果
+    int fmm_all_cap;
+    force_count count; //force_get_countで返す
+} force_ctx;
+
+typedef struct {
+    solver_type solver;
+    double G;     //重力定数
+    double theta; //Barnes-Hut, FMMの開き角(小さいほど正確で遅い)
+    double eps;   //Plummerソフトニング長
+    int order;    //FMMの展開の次数
+    int symmetric; //直接計算で作用反作用を使い、一つの組を一度だけ計算する
+    int mixed;    //直接計算で組ごとの計算を単精度、和を倍精度で行う(symmetricより優先)
+    int grid;     //PMの一辺の格子の数(2の累乗)
+    double box;   //PMの周期の長さ(箱は [-box/2, box/2)^3)
+    force_ctx *ctx; //作業領域(force_initで渡したもの)
+} force_param;
+
+/*
+ * 既定値(直接計算, ソフトニングなし)で初期化し、作業領域ctxを空にしてpから使うようにする。
+ * ctxは使い終わったらforce_ctx_freeで解放する。
+ */
+void force_init(force_param *p, double G, force_ctx *ctx);
+void force_ctx_free(force_ctx *ctx);
+
+/* "direct", "bh", "fmm", "pm" を solver_type に直す。知らない名前なら-1 */
+int force_parse_solver(const char *name);
+const char *force_solver_name(solver_type s);
+
+/* 全ての星の加速度を求める */
+void force_accel(const force_param *p, int n, const double *m,
+                 const double (*r)[3], double (*a)[3]);
+
+/*
+ * active[0..nactive-1]番目の星の加速度だけを求める(他の星のaは変えない)。
+ * activeがNULLなら全ての星を求める。
+ * FMMで求める星が全体の1/4未満のときはBarnes-Hut木で計算する。PMは毎回格子全体を解く。
+ */
+void force_accel_active(const force_param *p, int n, const double *m,
+                        const double (*r)[3], int nactive, const int *active,
+                        double (*a)[3]);
+
+/*
+ * 全ての組の位置エネルギー -G Σ m_i m_j / sqrt(r_ij^2 + eps^2) を求める。
+ * 直接計算のときは組を一度ずつ足し、Barnes-Hut, FMMのときはBarnes-Hut木で近似する。
+ * PMのときは格子のポテンシャルを使う(周期の像との位置エネルギーも含む)。
+ * どちらもスレッドプールで並列に計算する。
+ */
+double force_potential(const force_param *p, int n, const double *m, const double (*r)[3]);
+
+/* pの作業領域でこれまでに力を計算した量 */
+void force_get_count(const force_param *p, force_count *c);
+
+/*
+ * 近似解法(と混合精度の直接計算)の誤差を、nsample個の星について倍精度の直接計算と比べて求める。
+ * rms, maxには |a - a_direct| / |a_direct| の二乗平均平方根と最大値が入る。
+ * PMは周期境界なので比べない(0を返す)。
+ */
+void force_error(const force_param *p, int n, const double *m,
+                 const double (*r)[3], int nsample, double *rms, double *max);
+
+#endif
@@ -0,0 +1,509 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "initcond.h"
+#include "pool.h"
+
+#define IC_FIELDS 7
+#define CHUNK_BYTES (4 << 20) //CSVを分けるかたまりの大きさの目安
+
+/* ファイルをメモリに写像する **********************************************/
+static const char *map_file(const char *path, size_t *size, int *fd)
+{
+    struct stat st;
+
+    if ((*fd = open(path, O_RDONLY)) < 0) {
+        fprintf(stderr, "error: cannot open %s.\n", path);
+        return NULL;
+    }
+    if (fstat(*fd, &st) != 0) {
+        fprintf(stderr, "error: cannot stat %s.\n", path);
+        close(*fd);
+        return NULL;
+    }
+    *size = (size_t) st.st_size;
+    if (*size == 0) return "";
+
+    void *p = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, *fd, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "error: cannot map %s.\n", path);
+        close(*fd);
+        return NULL;
+    }
+    madvise(p, *size, MADV_SEQUENTIAL);
+    return (const char *) p;
+}
+
+static void unmap_file(const char *data, size_t size, int fd)
+{
+    if (size > 0) munmap((void *) data, size);
+    close(fd);
+}
+
+/*
+ * CSV *********************************************************************
+ * かたまりkは [begin[k], begin[k + 1]) の範囲で始まる行を受け持つ。
+ * 境界は改行の直後にそろえてあるので、行がかたまりをまたぐことはない。
+ */
+typedef struct {
+    const char *data;
+    size_t size;
+    int nchunk;
+    size_t *begin;
+    long *count;  //かたまりごとの星の数(2回目は書き込む位置)
+    long *error;  //読めなかった行の先頭の位置(なければ-1)
+    bodies *b;
+    int counter;
+} csv_task;
+
+/* 星の行かどうか(空行, コメント, 見出しは星ではない) */
+static int is_record(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if (p == end || *p == '\n' || *p == '#') return 0;
+    return !isalpha((unsigned char) *p);
+}
+
+static const char *next_line(const char *p, const char *end)
+{
+    const char *q = (const char *) memchr(p, '\n', (size_t) (end - p));
+    return q == NULL ? end : q + 1;
+}
+
+static void csv_count(void *arg, int tid, int nthreads)
+{
+    csv_task *task = (csv_task *) arg;
+    int k, dummy;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->nchunk, 1, &k, &dummy)) {
+        const char *p = task->data + task->begin[k];
+        const char *end = task->data + task->begin[k + 1];
+        long count = 0;
+        while (p < end) {
+            const char *q = next_line(p, task->data + task->size);
+            if (is_record(p, q)) count++;
+            p = q;
+        }
+        task->count[k] = count;
+    }
+}
+
+/*
+ * 仮数が15桁以下で10の指数が22以下なら、仮数も10の累乗もdoubleで正確に表せるので、
+ * 1回の掛け算か割り算で正しく丸めた値になる。それ以外なら0を返してstrtodに任せる。
+ */
+static int fast_number(const char *s, int len, double *x)
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *end = s + len;
+    unsigned long long mant = 0;
+    int digits = 0, exp10 = 0, negative = 0;
+
+    if (s < end && (*s == '-' || *s == '+')) negative = (*s++ == '-');
+    const char *start = s;
+    while (s < end && *s == '0') s++; //先頭の0は桁に数えない
+    while (s < end && isdigit((unsigned char) *s)) {
+        mant = mant * 10 + (unsigned long long) (*s++ - '0');
+        digits++;
+    }
+    if (s < end && *s == '.') {
+        s++;
+        if (digits == 0) {
+            while (s < end && *s == '0') {
+                s++;
+                exp10--;
+            }
+        }
+        while (s < end && isdigit((unsigned char) *s)) {
+            mant = mant * 10 + (unsigned long long) (*s++ - '0');
+            digits++;
+            exp10--;
+        }
+    }
+    if (digits > 15 || (digits == 0 && !(s > start && isdigit((unsigned char) s[-1])))) {
+        return 0; //桁が多すぎるか、数字が一つもない
+    }
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        s++;
+        int e = 0, eneg = 0;
+        if (s < end && (*s == '-' || *s == '+')) eneg = (*s++ == '-');
+        if (s == end) return 0;
+        while (s < end && isdigit((unsigned char) *s) && e < 1000) {
+            e = e * 10 + (*s++ - '0');
+        }
+        exp10 += eneg ? -e : e;
+    }
+    if (s != end || exp10 < -22 || exp10 > 22) return 0;
+
+    double v = (double) mant;
+    v = exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+    *x = negative ? -v : v;
+    return 1;
+}
+
+/* 1つの数を読む。strtodに渡すときは区切りまでを短い領域に写す(ファイルの終わりを越えないため) */
+static const char *parse_field(const char *p, const char *end, double *x)
+{
+    char buf[64];
+    int len = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    const char *s = p;
+    while (p < end && *p != ',' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+        p++;
+    }
+    len = (int) (p - s);
+    if (len == 0 || len >= (int) sizeof(buf)) return NULL;
+    if (!fast_number(s, len, x)) {
+        memcpy(buf, s, (size_t) len);
+        buf[len] = '\0';
+        char *stop;
+        *x = strtod(buf, &stop);
+        if (*stop != '\0') return NULL;
+    }
+
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == ',') p++;
+    return p;
+}
+
+static void csv_parse(void *arg, int tid, int nthreads)
+{
+    csv_task *task = (csv_task *) arg;
+    bodies *b = task->b;
+    int k, dummy;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, task->nchunk, 1, &k, &dummy)) {
+        const char *p = task->data + task->begin[k];
+        const char *end = task->data + task->begin[k + 1];
+        long i = task->count[k];
+        task->error[k] = -1;
+        while (p < end) {
+            const char *q = next_line(p, task->data + task->size);
+            if (is_record(p, q)) {
+                double f[IC_FIELDS];
+                const char *s = p;
+                for (int c = 0; c < IC_FIELDS && s != NULL; c++) {
+                    s = parse_field(s, q, &f[c]);
+                }
+                if (s == NULL) {
+                    task->error[k] = p - task->data;
+                    break;
+                }
+                b->m[i] = f[0];
+                b->x[i] = f[1];
+                b->y[i] = f[2];
+                b->z[i] = f[3];
+                b->vx[i] = f[4];
+                b->vy[i] = f[5];
+                b->vz[i] = f[6];
+                i++;
+            }
+            p = q;
+        }
+    }
+}
+
+static int load_csv(const char *path, const char *data, size_t size, bodies *b)
+{
+    csv_task task;
+    int k;
+
+    task.data = data;
+    task.size = size;
+    task.nchunk = (int) (size / CHUNK_BYTES) + 1;
+    if (task.nchunk < 4 * pool_size() && size > 4096) task.nchunk = 4 * pool_size();
+    task.begin = (size_t *) malloc(sizeof(size_t) * (size_t) (task.nchunk + 1));
+    task.count = (long *) malloc(sizeof(long) * (size_t) task.nchunk);
+    task.error = (long *) malloc(sizeof(long) * (size_t) task.nchunk);
+    if (task.begin == NULL || task.count == NULL || task.error == NULL) {
+        fprintf(stderr, "error: cannot allocate %s.\n", path);
+        exit(1);
+    }
+
+    //かたまりの境界を次の行の始まりまでずらす
+    task.begin[0] = 0;
+    for (k = 1; k < task.nchunk; k++) {
+        size_t pos = size / (size_t) task.nchunk * (size_t) k;
+        if (pos < task.begin[k - 1]) pos = task.begin[k - 1];
+        task.begin[k] = (size_t) (next_line(data + pos, data + size) - data);
+    }
+    task.begin[task.nchunk] = size;
+
+    //1回目: 星の数を数える
+    task.counter = 0;
+    pool_run(csv_count, &task);
+    long total = 0;
+    for (k = 0; k < task.nchunk; k++) {
+        const long c = task.count[k];
+        task.count[k] = total;
+        total += c;
+    }
+
+    int result = 0;
+    if (total > INT_MAX - BODIES_PAD) {
+        fprintf(stderr, "error: too many stars in %s.\n", path);
+        result = -1;
+    } else {
+        //2回目: それぞれの位置に読み込む
+        bodies_resize(b, (int) total);
+        task.b = b;
+        task.counter = 0;
+        pool_run(csv_parse, &task);
+        for (k = 0; k < task.nchunk; k++) {
+            if (task.error[k] < 0) continue;
+            long line = 1;
+            for (long q = 0; q < task.error[k]; q++) {
+                if (data[q] == '\n') line++;
+            }
+            fprintf(stderr, "error: %s:%ld: expected %d numbers.\n", path, line, IC_FIELDS);
+            result = -1;
+            break;
+        }
+    }
+
+    free(task.begin);
+    free(task.count);
+    free(task.error);
+    return result;
+}
+
+/* バイナリ ****************************************************************/
+typedef struct {
+    const double *rec;
+    bodies *b;
+    int counter;
+} bin_task;
+
+static void bin_copy(void *arg, int tid, int nthreads)
+{
+    bin_task *task = (bin_task *) arg;
+    bodies *b = task->b;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, b->n, 1 << 16, &begin, &end)) {
+        for (int i = begin; i < end; i++) {
+            const double *f = task->rec + (size_t) i * IC_FIELDS;
+            b->m[i] = f[0];
+            b->x[i] = f[1];
+            b->y[i] = f[2];
+            b->z[i] = f[3];
+            b->vx[i] = f[4];
+            b->vy[i] = f[5];
+            b->vz[i] = f[6];
+        }
+    }
+}
+
+static int load_binary(const char *path, const char *data, size_t size, bodies *b)
+{
+    ic_header h;
+
+    memcpy(&h, data, sizeof(h));
+    if (h.n > (unsigned long long) (INT_MAX - BODIES_PAD) ||
+        size != sizeof(h) + h.n * IC_FIELDS * sizeof(double)) {
+        fprintf(stderr, "error: %s is broken (%llu stars, %zu bytes).\n", path, h.n, size);
+        return -1;
+    }
+    bodies_resize(b, (int) h.n);
+    bin_task task = {(const double *) (data + sizeof(h)), b, 0};
+    pool_run(bin_copy, &task);
+    return 0;
+}
+
+/* 読み込み ****************************************************************/
+int ic_load(const char *path, bodies *b)
+{
+    size_t size;
+    int fd, result;
+
+    const char *data = map_file(path, &size, &fd);
+    if (data == NULL) return -1;
+
+    if (size >= sizeof(ic_header) && memcmp(data, IC_MAGIC, 8) == 0) {
+        result = load_binary(path, data, size, b);
+    } else {
+        result = load_csv(path, data, size, b);
+    }
+    unmap_file(data, size, fd);
+    return result;
+}
+
+/* 書き出し ****************************************************************/
+int ic_save(const char *path, const bodies *b)
+{
+    FILE *fp;
+    ic_header h;
+
+    if ((fp = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "error: cannot open %s.\n", path);
+        return -1;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, IC_MAGIC, 8);
+    h.n = (unsigned long long) b->n;
+    fwrite(&h, sizeof(h), 1, fp);
+    for (int i = 0; i < b->n; i++) {
+        const double f[IC_FIELDS] = {b->m[i], b->x[i], b->y[i], b->z[i],
+                                     b->vx[i], b->vy[i], b->vz[i]};
+        fwrite(f, sizeof(double), IC_FIELDS, fp);
+    }
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "error: cannot write %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/* 試験用の初期条件 ********************************************************/
+int ic_parse_model(const char *name)
+{
+    if (strcmp(name, "plummer") == 0) return IC_PLUMMER;
+    if (strcmp(name, "cold") == 0) return IC_COLD;
+    if (strcmp(name, "disk") == 0) return IC_DISK;
+    return -1;
+}
+
+const char *ic_model_name(ic_model model)
+{
+    switch (model) {
+    case IC_PLUMMER: return "plummer";
+    case IC_COLD: return "cold";
+    case IC_DISK: return "disk";
+    }
+    return "unknown";
+}
+
+/* [0, 1)の一様乱数 (splitmix64) */
+static double uniform(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (double) (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* 長さlenの向きがばらばらなベクトル */
+static void isotropic(unsigned long long *state, double len, double *x, double *y, double *z)
+{
+    const double c = 2.0 * uniform(state) - 1.0;
+    const double s = sqrt(1.0 - c * c);
+    const double phi = 2.0 * M_PI * uniform(state);
+    *x = len * s * cos(phi);
+    *y = len * s * sin(phi);
+    *z = len * c;
+}
+
+static void plummer(bodies *b, unsigned long long *state)
+{
+    const double scale = 3.0 * M_PI / 16.0; //N体単位にするための長さの倍率
+
+    for (int i = 0; i < b->n; i++) {
+        double r, q, g;
+        do { //遠すぎる星は作り直す
+            r = 1.0 / sqrt(pow(uniform(state) + 1e-300, -2.0 / 3.0) - 1.0);
+        } while (r > 10.0);
+        do { //速さの分布 q^2 (1 - q^2)^3.5 から棄却法で選ぶ
+            q = uniform(state);
+            g = 0.1 * uniform(state);
+        } while (g > q * q * pow(1.0 - q * q, 3.5));
+        const double ve = sqrt(2.0) * pow(1.0 + r * r, -0.25); //脱出速度
+
+        b->m[i] = 1.0 / b->n;
+        isotropic(state, r * scale, &b->x[i], &b->y[i], &b->z[i]);
+        isotropic(state, q * ve / sqrt(scale), &b->vx[i], &b->vy[i], &b->vz[i]);
+    }
+}
+
+static void cold(bodies *b, unsigned long long *state)
+{
+    for (int i = 0; i < b->n; i++) {
+        b->m[i] = 1.0 / b->n;
+        isotropic(state, cbrt(uniform(state)), &b->x[i], &b->y[i], &b->z[i]);
+        b->vx[i] = b->vy[i] = b->vz[i] = 0.0;
+    }
+}
+
+static void disk(bodies *b, unsigned long long *state)
+{
+    const double center = b->n > 1 ? 0.9 : 1.0; //中心の星の質量
+    const double rin = 0.1, rout = 1.0;
+
+    b->m[0] = center;
+    b->x[0] = b->y[0] = b->z[0] = 0.0;
+    b->vx[0] = b->vy[0] = b->vz[0] = 0.0;
+    for (int i = 1; i < b->n; i++) {
+        //面密度が一様になるように半径を選ぶ
+        const double f = uniform(state);
+        const double r = sqrt(rin * rin + f * (rout * rout - rin * rin));
+        const double phi = 2.0 * M_PI * uniform(state);
+        //内側の質量を球対称とみなして円軌道の速さを決める
+        const double v = sqrt((center + (1.0 - center) * f) / r);
+
+        b->m[i] = (1.0 - center) / (b->n - 1);
+        b->x[i] = r * cos(phi);
+        b->y[i] = r * sin(phi);
+        b->z[i] = 0.01 * rout * (uniform(state) - 0.5);
+        b->vx[i] = -v * sin(phi);
+        b->vy[i] = v * cos(phi);
+        b->vz[i] = 0.0;
+    }
+}
+
+void ic_generate(ic_model model, int n, unsigned long long seed, bodies *b)
+{
+    unsigned long long state = seed;
+    double c[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}, mtotal = 0.0;
+
+    bodies_resize(b, n);
+    if (n <= 0) return;
+    switch (model) {
+    case IC_PLUMMER:
+        plummer(b, &state);
+        break;
+    case IC_COLD:
+        cold(b, &state);
+        break;
+    case IC_DISK:
+        disk(b, &state);
+        break;
+    }
+
+    //重心を原点に置いて止める
+    for (int i = 0; i < n; i++) {
+        mtotal += b->m[i];
+        c[0] += b->m[i] * b->x[i];
+        c[1] += b->m[i] * b->y[i];
+        c[2] += b->m[i] * b->z[i];
+        c[3] += b->m[i] * b->vx[i];
+        c[4] += b->m[i] * b->vy[i];
+        c[5] += b->m[i] * b->vz[i];
+    }
+    for (int k = 0; k < 6; k++) {
+        c[k] /= mtotal;
+    }
+    for (int i = 0; i < n; i++) {
+        b->x[i] -= c[0];
+        b->y[i] -= c[1];
+        b->z[i] -= c[2];
+        b->vx[i] -= c[3];
+        b->vy[i] -= c[4];
+        b->vz[i] -= c[5];
+    }
+}
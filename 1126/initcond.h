@@ -0,0 +1,52 @@
+#ifndef INITCOND_H
+#define INITCOND_H
+
+#include "bodies.h"
+
+/*
+ * 初期条件の読み込み
+ * CSV: 1行に1つの星を "m, x, y, z, vx, vy, vz" の順に書く(区切りはカンマか空白)。
+ *      '#' で始まる行と、英字で始まる行(見出し)は読み飛ばす。
+ *      ファイルをメモリに写像してスレッドの数より多いかたまりに分け、
+ *      スレッドプールで行数を数えてから、それぞれの位置に並列に読み込む。
+ * バイナリ: 先頭に ic_header、その後に星ごとに7個のdouble (m, x, y, z, vx, vy, vz)。
+ *      メモリに写像してそのまま成分ごとの配列に移す。
+ * 並列に読むときは、先にpool_startしておくこと。
+ */
+
+#define IC_MAGIC "NBODYIC1"
+
+typedef struct {
+    char magic[8];       //IC_MAGIC
+    unsigned long long n; //星の数
+} ic_header;
+
+/*
+ * pathの初期条件をbに読み込む。先頭がIC_MAGICならバイナリ、それ以外はCSVとして読む。
+ * 失敗したらメッセージを表示して-1を返す。
+ */
+int ic_load(const char *path, bodies *b);
+
+/* bをバイナリの初期条件として書き出す。失敗したら-1を返す */
+int ic_save(const char *path, const bodies *b);
+
+/*
+ * 試験用の初期条件を作る(G = 1, 全質量1, 重心は原点に静止させる)
+ *   plummer : Plummer球 (Aarseth, Henon, Wielen 1974の方法, N体単位で全エネルギー -1/4)
+ *   cold    : 半径1の一様な球で、速度0 (冷たい崩壊)
+ *   disk    : 質量0.9の中心の星と、その周りを円軌道で回る薄い円盤 (半径0.1から1)
+ * seedが同じなら同じ星を作る。
+ */
+typedef enum {
+    IC_PLUMMER,
+    IC_COLD,
+    IC_DISK
+} ic_model;
+
+/* "plummer", "cold", "disk" を ic_model に直す。知らない名前なら-1 */
+int ic_parse_model(const char *name);
+const char *ic_model_name(ic_model model);
+
+void ic_generate(ic_model model, int n, unsigned long long seed, bodies *b);
+
+#endif
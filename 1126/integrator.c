@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "integrator.h"
+
+/* 積分法の名前 ************************************************************/
+int integ_parse(const char *name)
+{
+    if (strcmp(name, "leapfrog") == 0) return INTEG_LEAPFROG;
+    if (strcmp(name, "yoshida4") == 0) return INTEG_YOSHIDA4;
+    if (strcmp(name, "forest-ruth") == 0) return INTEG_FOREST_RUTH;
+    return -1;
+}
+
+const char *integ_name(integrator_type type)
+{
+    switch (type) {
+    case INTEG_LEAPFROG: return "leapfrog";
+    case INTEG_YOSHIDA4: return "yoshida4";
+    case INTEG_FOREST_RUTH: return "forest-ruth";
+    }
+    return "unknown";
+}
+
+/* 初期化・解放 ************************************************************/
+void integ_init(integrator *it, integrator_type type)
+{
+    it->type = type;
+    it->n = 0;
+    it->cap = 0;
+    it->a = NULL;
+    it->ready = 0;
+    it->nforce = 0;
+}
+
+void integ_free(integrator *it)
+{
+    free(it->a);
+    integ_init(it, it->type);
+}
+
+void integ_reset(integrator *it)
+{
+    it->ready = 0;
+}
+
+/* チェックポイント ********************************************************/
+typedef struct {
+    int type;
+    int n;
+    int ready;
+    long nforce;
+} integ_header;
+
+void integ_save(const integrator *it, ckpt_writer *w)
+{
+    integ_header h;
+
+    memset(&h, 0, sizeof(h));
+    h.type = (int) it->type;
+    h.n = it->n;
+    h.ready = it->ready;
+    h.nforce = it->nforce;
+    ckpt_put(w, "integ", &h, sizeof(h));
+    ckpt_put(w, "integ.a", it->a, sizeof(double) * 3 * (size_t) (it->ready ? it->n : 0));
+}
+
+int integ_restore(integrator *it, const ckpt_reader *rd)
+{
+    integ_header h;
+
+    if (ckpt_read(rd, "integ", &h, sizeof(h)) != 0 || h.type != (int) it->type) return -1;
+    if (h.n > it->cap) {
+        it->a = (double (*)[3]) realloc(it->a, sizeof(double) * 3 * (size_t) h.n);
+        if (it->a == NULL) {
+            fprintf(stderr, "error: cannot allocate accelerations.\n");
+            exit(1);
+        }
+        it->cap = h.n;
+    }
+    if (ckpt_read(rd, "integ.a", it->a, sizeof(double) * 3 * (size_t) (h.ready ? h.n : 0)) != 0) {
+        return -1;
+    }
+    it->n = h.n;
+    it->ready = h.ready;
+    it->nforce = h.nforce;
+    return 0;
+}
+
+/* 加速度を求める **********************************************************/
+static void accel(integrator *it, const force_param *p, int n, const double *m,
+                  double (*r)[3])
+{
+    force_accel(p, n, m, (const double (*)[3]) r, it->a);
+    it->nforce++;
+}
+
+/* v += a * h **************************************************************/
+static void kick(const integrator *it, int n, const double *m, double (*v)[3], double h)
+{
+    for (int i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        for (int k = 0; k < 3; k++) {
+            v[i][k] += it->a[i][k] * h;
+        }
+    }
+}
+
+/* r += v * h **************************************************************/
+static void drift(int n, const double *m, double (*r)[3], double (*v)[3], double h)
+{
+    for (int i = 0; i < n; i++) {
+        if (m[i] == 0) continue;
+        for (int k = 0; k < 3; k++) {
+            r[i][k] += v[i][k] * h;
+        }
+    }
+}
+
+/* キック・ドリフト・キック(始めの加速度はit->aにあるものを使う) ************/
+static void kdk(integrator *it, const force_param *p, int n, const double *m,
+                double (*r)[3], double (*v)[3], double h)
+{
+    kick(it, n, m, v, 0.5 * h);
+    drift(n, m, r, v, h);
+    accel(it, p, n, m, r);
+    kick(it, n, m, v, 0.5 * h);
+}
+
+/* 1ステップ進める *********************************************************/
+void integ_step(integrator *it, const force_param *p, int n, const double *m,
+                double (*r)[3], double (*v)[3], double dt)
+{
+    //蛙跳び法を w1, w0, w1 の重みでつなげると4次になる(w0は負)
+    const double w1 = 1.0 / (2.0 - cbrt(2.0));
+    const double w0 = 1.0 - 2.0 * w1;
+
+    if (n > it->cap) {
+        it->a = (double (*)[3]) realloc(it->a, sizeof(double) * 3 * (size_t) n);
+        if (it->a == NULL) {
+            fprintf(stderr, "error: cannot allocate accelerations.\n");
+            exit(1);
+        }
+        it->cap = n;
+    }
+    if (n != it->n) {
+        it->n = n;
+        it->ready = 0;
+    }
+
+    switch (it->type) {
+    case INTEG_LEAPFROG:
+    case INTEG_YOSHIDA4:
+        if (!it->ready) {
+            accel(it, p, n, m, r);
+            it->ready = 1;
+        }
+        if (it->type == INTEG_LEAPFROG) {
+            kdk(it, p, n, m, r, v, dt);
+        } else {
+            kdk(it, p, n, m, r, v, w1 * dt);
+            kdk(it, p, n, m, r, v, w0 * dt);
+            kdk(it, p, n, m, r, v, w1 * dt);
+        }
+        break;
+    case INTEG_FOREST_RUTH:
+        //ドリフトから始めるので、保存した加速度は使わない
+        drift(n, m, r, v, 0.5 * w1 * dt);
+        accel(it, p, n, m, r);
+        kick(it, n, m, v, w1 * dt);
+        drift(n, m, r, v, 0.5 * (w0 + w1) * dt);
+        accel(it, p, n, m, r);
+        kick(it, n, m, v, w0 * dt);
+        drift(n, m, r, v, 0.5 * (w0 + w1) * dt);
+        accel(it, p, n, m, r);
+        kick(it, n, m, v, w1 * dt);
+        drift(n, m, r, v, 0.5 * w1 * dt);
+        it->ready = 0;
+        break;
+    }
+}
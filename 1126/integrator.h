@@ -0,0 +1,52 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "force.h"
+#include "checkpoint.h"
+
+/*
+ * シンプレクティック積分法
+ * どれも時間反転対称で、長い時間進めてもエネルギーの誤差が増え続けない。
+ *   leapfrog    : 蛙跳び法(キック・ドリフト・キック) 2次, 1ステップに力の計算1回
+ *   yoshida4    : 蛙跳び法を3回つなげた吉田の4次の方法, 力の計算3回
+ *   forest-ruth : ドリフトから始めるForest-Ruthの4次の方法, 力の計算3回
+ * 最後に求めた加速度を次のステップの最初に使い回すので、上の回数で済む。
+ */
+
+typedef enum {
+    INTEG_LEAPFROG,
+    INTEG_YOSHIDA4,
+    INTEG_FOREST_RUTH
+} integrator_type;
+
+typedef struct {
+    integrator_type type;
+    int n;
+    int cap;
+    double (*a)[3]; //最後に求めた加速度
+    int ready;      //aが今の座標の加速度なら1
+    long nforce;    //力を計算した回数
+} integrator;
+
+/* "leapfrog", "yoshida4", "forest-ruth" を integrator_type に直す。知らない名前なら-1 */
+int integ_parse(const char *name);
+const char *integ_name(integrator_type type);
+
+void integ_init(integrator *it, integrator_type type);
+void integ_free(integrator *it);
+
+/* 質量が変わったときなど、保存してある加速度を捨てる */
+void integ_reset(integrator *it);
+
+/*
+ * 次のステップに持ち越す状態(最後の加速度)をチェックポイントに書く・読む。
+ * 読むときは同じ種類でinteg_initしておくこと。合わなければ-1
+ */
+void integ_save(const integrator *it, ckpt_writer *w);
+int integ_restore(integrator *it, const ckpt_reader *rd);
+
+/* n個の星の座標rと速度vをdtだけ進める。質量0の星は動かさない。 */
+void integ_step(integrator *it, const force_param *p, int n, const double *m,
+                double (*r)[3], double (*v)[3], double dt);
+
+#endif
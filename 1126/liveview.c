@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+
+#include "liveview.h"
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+static void sleep_for(double sec)
+{
+    if (sec <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t) sec;
+    ts.tv_nsec = (long) ((sec - (double) ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+/* 1フレームをgnuplotのバイナリ形式で送る。書けなかったら-1 */
+static int send_frame(FILE *gp, const float *buf, int count)
+{
+    if (count == 0) return 0; //描く星がない
+    fprintf(gp, "splot '-' binary record=(%d) format='%%float%%float%%float' "
+            "using 1:2:3 with points pt 7 ps 1 notitle\n", count);
+    if (fwrite(buf, sizeof(float) * 3, (size_t) count, gp) != (size_t) count) return -1;
+    return fflush(gp) == 0 ? 0 : -1;
+}
+
+/* 送るスレッド ************************************************************/
+static void *view_main(void *p)
+{
+    live_view *v = (live_view *) p;
+
+    for (;;) {
+        pthread_mutex_lock(&v->lock);
+        while (!v->fresh && !v->quit) {
+            pthread_cond_wait(&v->ready, &v->lock);
+        }
+        if (v->quit) {
+            pthread_mutex_unlock(&v->lock);
+            break;
+        }
+        const int k = v->pending;
+        v->pending = v->sending;
+        v->sending = k;
+        v->fresh = 0;
+        pthread_mutex_unlock(&v->lock);
+
+        const double start = now();
+        if (send_frame(v->gp, v->buf[k], v->count[k]) != 0) {
+            fprintf(stderr, "warning: cannot write to gnuplot, live view stopped.\n");
+            __atomic_store_n(&v->broken, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        v->nsent++;
+        sleep_for(v->period - (now() - start)); //fps枚/秒を超えないように待つ
+    }
+    return NULL;
+}
+
+/* 開始・終了 **************************************************************/
+void lv_start(live_view *v, FILE *gp, double fps)
+{
+    signal(SIGPIPE, SIG_IGN); //gnuplotが終わっても計算は止めない(書き込みの失敗でわかる)
+
+    v->gp = gp;
+    v->period = fps > 0 ? 1.0 / fps : 0.0;
+    for (int k = 0; k < 3; k++) {
+        v->buf[k] = NULL;
+        v->count[k] = v->cap[k] = 0;
+    }
+    v->write = 0;
+    v->pending = 1;
+    v->sending = 2;
+    v->fresh = v->quit = v->broken = 0;
+    v->last = -1e300;
+    v->nsent = v->ndropped = 0;
+    pthread_mutex_init(&v->lock, NULL);
+    pthread_cond_init(&v->ready, NULL);
+    if (pthread_create(&v->thread, NULL, view_main, v) != 0) {
+        fprintf(stderr, "error: cannot create live view thread.\n");
+        exit(1);
+    }
+}
+
+void lv_stop(live_view *v)
+{
+    pthread_mutex_lock(&v->lock);
+    v->quit = 1;
+    pthread_cond_signal(&v->ready);
+    pthread_mutex_unlock(&v->lock);
+    pthread_join(v->thread, NULL);
+
+    for (int k = 0; k < 3; k++) {
+        free(v->buf[k]);
+        v->buf[k] = NULL;
+    }
+    pthread_mutex_destroy(&v->lock);
+    pthread_cond_destroy(&v->ready);
+}
+
+/* フレームの受け渡し ******************************************************/
+int lv_wants(live_view *v)
+{
+    //brokenは送るスレッドが書く。古い値を読んでも1フレーム余分に写すだけ
+    return !__atomic_load_n(&v->broken, __ATOMIC_RELAXED) && now() - v->last >= v->period;
+}
+
+float *lv_buffer(live_view *v, int n)
+{
+    const int k = v->write; //writeは計算のスレッドしか変えない
+    if (n > v->cap[k]) {
+        v->buf[k] = (float *) realloc(v->buf[k], sizeof(float) * 3 * (size_t) n);
+        if (v->buf[k] == NULL) {
+            fprintf(stderr, "error: cannot allocate live view buffer.\n");
+            exit(1);
+        }
+        v->cap[k] = n;
+    }
+    return v->buf[k];
+}
+
+void lv_publish(live_view *v, int count)
+{
+    v->count[v->write] = count;
+    v->last = now();
+
+    pthread_mutex_lock(&v->lock);
+    if (v->fresh) v->ndropped++; //送る前のフレームは捨てる
+    const int k = v->pending;
+    v->pending = v->write;
+    v->write = k;
+    v->fresh = 1;
+    pthread_cond_signal(&v->ready);
+    pthread_mutex_unlock(&v->lock);
+}
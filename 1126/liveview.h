@@ -0,0 +1,49 @@
+#ifndef LIVEVIEW_H
+#define LIVEVIEW_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/*
+ * gnuplotで計算の様子を見る
+ * 星の座標をfloatの並びにしてgnuplotのバイナリ形式で送る。送るのは別のスレッドで、
+ * 計算のスレッドは座標を写すだけで待たない。
+ * 領域は3つ(書いている途中, 送るのを待っている, 送っている)を回して使い、
+ * 送る前に次のフレームが来たら古い方を捨てる(いつも一番新しいフレームを描く)。
+ * フレームは1秒にfps枚まで受け取り、それより速くは写さない。
+ */
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready; //新しいフレームが来た
+    FILE *gp;
+    double period;        //フレームの最短の間隔(秒)
+    float *buf[3];        //星ごとに x, y, z
+    int count[3];         //星の数
+    int cap[3];
+    int write, pending, sending; //書いている途中, 送るのを待っている, 送っているbufの番号
+    int fresh;            //pendingがまだ送っていないフレームなら1
+    int quit;
+    int broken;           //gnuplotに書けなくなったら1
+    double last;          //最後にフレームを受け取った時刻
+    long nsent;           //送ったフレームの数
+    long ndropped;        //送る前に新しいフレームが来て捨てた数
+} live_view;
+
+/* gpにfps枚/秒までのフレームを送るスレッドを始める */
+void lv_start(live_view *v, FILE *gp, double fps);
+
+/* 送っているフレームを送り終えてからスレッドを止める(gpは閉じない) */
+void lv_stop(live_view *v);
+
+/* 今フレームを渡すと使われるなら1(前のフレームから1/fps秒たっていれば) */
+int lv_wants(live_view *v);
+
+/* 星n個分の書き込み用の領域を返す。書き終えたらlv_publishで渡す */
+float *lv_buffer(live_view *v, int n);
+
+/* lv_bufferに書いたcount個の星を次のフレームとして渡す */
+void lv_publish(live_view *v, int count);
+
+#endif
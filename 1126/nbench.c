@@ -0,0 +1,347 @@
+/**
+ * 力の計算と積分法の速さと精度を測る。
+ * 試験用の初期条件(plummer, cold, disk)を作り、初期条件・星の数・解法・積分法・スレッド数の
+ * 組み合わせごとに決まった時間だけ進めて、1ステップにかかった時間と
+ * 全エネルギーの相対誤差をCSVで出力する。直接計算は倍精度と混合精度(-P)を比べられる。
+ * 積分法はシンプレクティック積分法とブロック時間刻みのほかに、gravity3.c, gravity3_RK4.c の
+ * オイラー法(euler)と四次のルンゲクッタ法(rk4)も選べる(nbody.c の nb_step_euler, nb_step_rk4 を使う)。
+ * energy0は初期条件の全エネルギー、energyは進めた後の全エネルギー。
+ * 力の誤差は初期条件での加速度を倍精度の直接計算と比べたもの。
+ * 速さは実際に計算した相互作用の数(PMは解いた格子点の数)と、比べるための目安として
+ * 直接計算に直した組の数の両方で出す。
+ * 使い方: nbench [options] > result.csv
+ * コンパイル: gcc -O2 -pthread nbench.c force.c bhtree.c fmm.c bodies.c direct.c pool.c blockstep.c integrator.c initcond.c diag.c checkpoint.c pm.c nbody.c -lm -o nbench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "force.h"
+#include "pool.h"
+#include "blockstep.h"
+#include "integrator.h"
+#include "initcond.h"
+#include "diag.h"
+#include "nbody.h"
+
+#define MAX_LIST 32
+#define ACCEL_SAMPLE 256 //力の誤差を測る星の数
+
+/* コンマ区切りの並びを分ける。要素の数を返す */
+static int split(char *s, char *item[], int max)
+{
+    int k = 0;
+    for (char *p = strtok(s, ","); p != NULL && k < max; p = strtok(NULL, ",")) {
+        item[k++] = p;
+    }
+    return k;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+/*
+ * 全エネルギー(位置エネルギーは倍精度の直接計算で全ての組について足す)
+ * PMは周期境界の系なので、PM自身のポテンシャルで測る
+ */
+static double energy(const force_param *p, int n, const double *m,
+                     const double (*r)[3], const double (*v)[3])
+{
+    force_param exact = *p;
+    diag_state d;
+
+    if (p->solver != SOLVER_PM) exact.solver = SOLVER_DIRECT;
+    exact.mixed = 0;
+    diag_measure(&exact, n, m, r, v, &d);
+    return d.energy;
+}
+
+/* force.cで加速度を求める(nb_simから呼ばれる) */
+static void accel_force(void *arg, int n, const double *m, const double *r, double *a)
+{
+    force_accel((const force_param *) arg, n, m, (const double (*)[3]) r, (double (*)[3]) a);
+}
+
+/* オイラー法か四次のルンゲクッタ法で steps ステップ進める(r, v を書き換える) */
+static void run_nbody(const force_param *p, int rk4, int n, const double *m,
+                      double (*r)[3], double (*v)[3], long steps, double dt)
+{
+    nb_sim sim;
+
+    nb_init(&sim, 3, p->G);
+    nb_set_accel(&sim, accel_force, (void *) p);
+    nb_resize(&sim, n);
+    for (int i = 0; i < n; i++) {
+        nb_set_star(&sim, i, m[i], r[i], v[i]);
+    }
+    for (long step = 0; step < steps; step++) {
+        if (rk4) {
+            nb_step_rk4(&sim, dt);
+        } else {
+            nb_step_euler(&sim, dt);
+        }
+    }
+    memcpy(r, sim.r, sizeof(double) * 3 * (size_t) n);
+    memcpy(v, sim.v, sizeof(double) * 3 * (size_t) n);
+    nb_free(&sim);
+}
+
+/* 使い方 ******************************************************************/
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [options] > result.csv\n", prog);
+    fprintf(stderr, "  -m, --model=LIST      初期条件 (plummer, cold, disk, 既定値 全て)\n");
+    fprintf(stderr, "  -N, --stars=LIST      星の数 (既定値 100,1000,10000)\n");
+    fprintf(stderr, "  -s, --solver=LIST     解法 (direct, bh, fmm, pm, 既定値 direct,bh,fmm)\n");
+    fprintf(stderr, "  -P, --precision=LIST  直接計算の精度 (double, mixed, 既定値 double)\n");
+    fprintf(stderr, "  -i, --integrator=LIST 積分法 (leapfrog, yoshida4, forest-ruth, block, euler, rk4, 既定値 leapfrog,yoshida4)\n");
+    fprintf(stderr, "  -j, --threads=LIST    スレッドの数 (既定値 1)\n");
+    fprintf(stderr, "  -T, --time=TIME       進める時間 (既定値 0.25)\n");
+    fprintf(stderr, "  -d, --dt=DT           時間刻み (ブロック時間刻みでは一番長い刻み, 既定値 1/64)\n");
+    fprintf(stderr, "  -e, --eps=EPS         Plummerソフトニング長 (既定値 0.05)\n");
+    fprintf(stderr, "  -t, --theta=THETA     Barnes-Hut, FMMの開き角 (既定値 0.5)\n");
+    fprintf(stderr, "  -p, --order=P         FMMの展開の次数 (既定値 4)\n");
+    fprintf(stderr, "  -g, --grid=NG         PMの一辺の格子の数 (2の累乗, 既定値 64)\n");
+    fprintf(stderr, "  -B, --box=L           PMの周期の箱の一辺 (既定値 100)\n");
+    fprintf(stderr, "  -b, --eta=ETA         ブロック時間刻みの精度 (既定値 0.02)\n");
+    fprintf(stderr, "  -L, --levels=L        ブロック時間刻みの段の数 (既定値 8)\n");
+    fprintf(stderr, "  -D, --direct-max=N    直接計算を試す星の数の上限 (既定値 100000)\n");
+    fprintf(stderr, "  -E, --energy-max=N    エネルギーを測る星の数の上限 (既定値 100000)\n");
+    fprintf(stderr, "  -r, --seed=SEED       乱数の種 (既定値 1)\n");
+}
+
+/**************************************************************************/
+int main(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"model",      required_argument, NULL, 'm'},
+        {"stars",      required_argument, NULL, 'N'},
+        {"solver",     required_argument, NULL, 's'},
+        {"precision",  required_argument, NULL, 'P'},
+        {"integrator", required_argument, NULL, 'i'},
+        {"threads",    required_argument, NULL, 'j'},
+        {"time",       required_argument, NULL, 'T'},
+        {"dt",         required_argument, NULL, 'd'},
+        {"eps",        required_argument, NULL, 'e'},
+        {"theta",      required_argument, NULL, 't'},
+        {"order",      required_argument, NULL, 'p'},
+        {"grid",       required_argument, NULL, 'g'},
+        {"box",        required_argument, NULL, 'B'},
+        {"eta",        required_argument, NULL, 'b'},
+        {"levels",     required_argument, NULL, 'L'},
+        {"direct-max", required_argument, NULL, 'D'},
+        {"energy-max", required_argument, NULL, 'E'},
+        {"seed",       required_argument, NULL, 'r'},
+        {"help",       no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    char models[256] = "plummer,cold,disk", sizes[256] = "100,1000,10000";
+    char solvers[256] = "direct,bh,fmm", precisions[256] = "double", integs[256] = "leapfrog,yoshida4", threads[256] = "1";
+    double stop_time = 0.25, dt = 1.0 / 64, eta = 0.02;
+    int levels = 8, direct_max = 100000, energy_max = 100000;
+    unsigned long long seed = 1;
+    force_param force;
+    force_ctx fctx;
+    int opt;
+
+    force_init(&force, 1.0, &fctx);
+    force.eps = 0.05;
+    while ((opt = getopt_long(argc, argv, "m:N:s:P:i:j:T:d:e:t:p:g:B:b:L:D:E:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'm': snprintf(models, sizeof(models), "%s", optarg); break;
+        case 'N': snprintf(sizes, sizeof(sizes), "%s", optarg); break;
+        case 's': snprintf(solvers, sizeof(solvers), "%s", optarg); break;
+        case 'P': snprintf(precisions, sizeof(precisions), "%s", optarg); break;
+        case 'i': snprintf(integs, sizeof(integs), "%s", optarg); break;
+        case 'j': snprintf(threads, sizeof(threads), "%s", optarg); break;
+        case 'T': stop_time = atof(optarg); break;
+        case 'd': dt = atof(optarg); break;
+        case 'e': force.eps = atof(optarg); break;
+        case 't': force.theta = atof(optarg); break;
+        case 'p': force.order = atoi(optarg); break;
+        case 'g': force.grid = atoi(optarg); break;
+        case 'B': force.box = atof(optarg); break;
+        case 'b': eta = atof(optarg); break;
+        case 'L': levels = atoi(optarg); break;
+        case 'D': direct_max = atoi(optarg); break;
+        case 'E': energy_max = atoi(optarg); break;
+        case 'r': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    char *model[MAX_LIST], *size[MAX_LIST], *solver[MAX_LIST], *precision[MAX_LIST];
+    char *integ[MAX_LIST], *thread[MAX_LIST];
+    const int nmodel = split(models, model, MAX_LIST);
+    const int nsize = split(sizes, size, MAX_LIST);
+    const int nsolver = split(solvers, solver, MAX_LIST);
+    const int nprecision = split(precisions, precision, MAX_LIST);
+    const int ninteg = split(integs, integ, MAX_LIST);
+    const int nthread = split(threads, thread, MAX_LIST);
+    for (int k = 0; k < nmodel; k++) {
+        if (ic_parse_model(model[k]) < 0) {
+            fprintf(stderr, "error: unknown model %s.\n", model[k]);
+            return 1;
+        }
+    }
+    for (int k = 0; k < nsolver; k++) {
+        if (force_parse_solver(solver[k]) < 0) {
+            fprintf(stderr, "error: unknown solver %s.\n", solver[k]);
+            return 1;
+        }
+    }
+    for (int k = 0; k < nprecision; k++) {
+        if (strcmp(precision[k], "double") != 0 && strcmp(precision[k], "mixed") != 0) {
+            fprintf(stderr, "error: unknown precision %s.\n", precision[k]);
+            return 1;
+        }
+    }
+    for (int k = 0; k < ninteg; k++) {
+        if (strcmp(integ[k], "block") != 0 && strcmp(integ[k], "euler") != 0 &&
+            strcmp(integ[k], "rk4") != 0 && integ_parse(integ[k]) < 0) {
+            fprintf(stderr, "error: unknown integrator %s.\n", integ[k]);
+            return 1;
+        }
+    }
+    for (int k = 0; k < nthread; k++) {
+        if (atoi(thread[k]) < 1) {
+            fprintf(stderr, "error: threads must be positive.\n");
+            return 1;
+        }
+    }
+
+    const long steps = (long) (stop_time / dt + 0.5);
+    bodies b;
+    bodies_init(&b);
+    printf("model,n,solver,precision,integrator,threads,steps,dt,seconds,seconds_per_step,"
+           "force_calls,stars_per_second,interactions_per_second,mesh_cells_per_second,direct_pairs_per_second,"
+           "accel_error_rms,accel_error_max,"
+           "energy0,energy,relative_energy_error\n");
+
+    for (int im = 0; im < nmodel; im++) {
+        for (int in = 0; in < nsize; in++) {
+            const int n = atoi(size[in]);
+            if (n < 1) continue;
+            ic_generate((ic_model) ic_parse_model(model[im]), n, seed, &b);
+
+            double *m = (double *) malloc(sizeof(double) * (size_t) n);
+            double (*r0)[3] = (double (*)[3]) malloc(sizeof(double) * 3 * (size_t) n);
+            double (*v0)[3] = (double (*)[3]) malloc(sizeof(double) * 3 * (size_t) n);
+            double (*r)[3] = (double (*)[3]) malloc(sizeof(double) * 3 * (size_t) n);
+            double (*v)[3] = (double (*)[3]) malloc(sizeof(double) * 3 * (size_t) n);
+            if (m == NULL || r0 == NULL || v0 == NULL || r == NULL || v == NULL) {
+                fprintf(stderr, "error: cannot allocate stars.\n");
+                return 1;
+            }
+            for (int i = 0; i < n; i++) {
+                m[i] = b.m[i];
+                r0[i][0] = b.x[i];
+                r0[i][1] = b.y[i];
+                r0[i][2] = b.z[i];
+                v0[i][0] = b.vx[i];
+                v0[i][1] = b.vy[i];
+                v0[i][2] = b.vz[i];
+            }
+
+            double e0 = 0.0;
+            for (int ij = 0; ij < nthread; ij++) {
+                pool_start(atoi(thread[ij]));
+                if (ij == 0 && n <= energy_max) {
+                    e0 = energy(&force, n, m, (const double (*)[3]) r0, (const double (*)[3]) v0);
+                }
+                for (int is = 0; is < nsolver * nprecision; is++) {
+                    //混合精度は直接計算にしか効かないので、他の解法では倍精度だけを測る
+                    const char *prec = precision[is % nprecision];
+                    force.solver = (solver_type) force_parse_solver(solver[is / nprecision]);
+                    force.mixed = strcmp(prec, "mixed") == 0;
+                    if (force.solver == SOLVER_DIRECT && n > direct_max) continue;
+                    if (force.solver != SOLVER_DIRECT && force.mixed) continue;
+
+                    //PMは周期境界なので、エネルギーの基準もPMで測り直し、加速度の誤差は空にする
+                    double e_ref = e0;
+                    if (force.solver == SOLVER_PM && n <= energy_max) {
+                        e_ref = energy(&force, n, m, (const double (*)[3]) r0, (const double (*)[3]) v0);
+                    }
+                    double err_rms, err_max;
+                    force_error(&force, n, m, (const double (*)[3]) r0, ACCEL_SAMPLE, &err_rms, &err_max);
+                    for (int ii = 0; ii < ninteg; ii++) {
+                        const int use_block = strcmp(integ[ii], "block") == 0;
+                        const int use_euler = strcmp(integ[ii], "euler") == 0;
+                        const int use_rk4 = strcmp(integ[ii], "rk4") == 0;
+                        integrator it;
+                        blockstep blk;
+                        force_count c0, c1;
+
+                        memcpy(r, r0, sizeof(double) * 3 * (size_t) n);
+                        memcpy(v, v0, sizeof(double) * 3 * (size_t) n);
+                        if (use_block) {
+                            block_init(&blk, dt, levels, eta);
+                        } else if (!use_euler && !use_rk4) {
+                            integ_init(&it, (integrator_type) integ_parse(integ[ii]));
+                        }
+
+                        force_get_count(&force, &c0);
+                        const double start = now();
+                        if (use_euler || use_rk4) {
+                            run_nbody(&force, use_rk4, n, m, r, v, steps, dt);
+                        } else {
+                            for (long step = 0; step < steps; step++) {
+                                if (use_block) {
+                                    block_step(&blk, &force, n, m, r, v);
+                                } else {
+                                    integ_step(&it, &force, n, m, r, v, dt);
+                                }
+                            }
+                        }
+                        const double wall = now() - start;
+                        force_get_count(&force, &c1);
+
+                        if (use_block) {
+                            block_free(&blk);
+                        } else if (!use_euler && !use_rk4) {
+                            integ_free(&it);
+                        }
+
+                        printf("%s,%d,%s,%s,%s,%s,%ld,%g,%.6f,%.6e,%ld,%.4e,%.4e,%.4e,%.4e,",
+                               model[im], n, solver[is / nprecision], prec, integ[ii], thread[ij],
+                               steps, dt, wall, steps > 0 ? wall / steps : 0.0, c1.ncall - c0.ncall,
+                               (double) (c1.nbody - c0.nbody) / wall, (c1.ninteract - c0.ninteract) / wall,
+                               (c1.ncell - c0.ncell) / wall, (c1.ndirect - c0.ndirect) / wall);
+                        if (force.solver == SOLVER_PM) {
+                            printf(",,");
+                        } else {
+                            printf("%.4e,%.4e,", err_rms, err_max);
+                        }
+                        if (n <= energy_max) {
+                            const double e1 = energy(&force, n, m, (const double (*)[3]) r,
+                                                     (const double (*)[3]) v);
+                            printf("%.10e,%.10e,%.4e\n", e_ref, e1, fabs((e1 - e_ref) / e_ref));
+                        } else {
+                            printf(",,\n"); //大きすぎるので測らない
+                        }
+                        fflush(stdout);
+                    }
+                }
+            }
+            free(m);
+            free(r0);
+            free(v0);
+            free(r);
+            free(v);
+        }
+    }
+    pool_stop();
+    force_ctx_free(&fctx);
+    bodies_free(&b);
+    return 0;
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nbody.h"
+
+/*
+ * 成分のループを持つ本体は常にインライン展開し、dimに定数を渡して呼ぶ。
+ * 2次元と3次元では成分のループが展開され、星のループだけが残る。
+ */
+#define INLINE static inline __attribute__((always_inline))
+
+/* 初期化・解放 ************************************************************/
+void nb_init(nb_sim *s, int dim, double G)
+{
+    s->dim = dim;
+    s->n = 0;
+    s->cap = 0;
+    s->G = G;
+    s->m = s->r = s->v = NULL;
+    s->accel = NULL;
+    s->accel_arg = NULL;
+    s->work_cap = 0;
+    s->rk4_cap = 0;
+    s->a = s->rs = s->vs = s->sr = s->sv = NULL;
+}
+
+void nb_free(nb_sim *s)
+{
+    free(s->m);
+    free(s->r);
+    free(s->v);
+    free(s->a);
+    free(s->rs);
+    free(s->vs);
+    free(s->sr);
+    free(s->sv);
+    nb_init(s, s->dim, s->G);
+}
+
+static double *grow(double *p, size_t count)
+{
+    p = (double *) realloc(p, sizeof(double) * (count > 0 ? count : 1));
+    if (p == NULL) {
+        fprintf(stderr, "error: cannot allocate stars.\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* 星の数を変える **********************************************************/
+void nb_resize(nb_sim *s, int n)
+{
+    const size_t d = (size_t) s->dim;
+    if (n > s->cap) {
+        s->m = grow(s->m, (size_t) n);
+        s->r = grow(s->r, (size_t) n * d);
+        s->v = grow(s->v, (size_t) n * d);
+        memset(s->m + s->cap, 0, sizeof(double) * (size_t) (n - s->cap));
+        memset(s->r + s->cap * d, 0, sizeof(double) * (size_t) (n - s->cap) * d);
+        memset(s->v + s->cap * d, 0, sizeof(double) * (size_t) (n - s->cap) * d);
+        s->cap = n;
+    }
+    s->n = n;
+}
+
+/* 作業領域を星の数に合わせる(足りないときだけ確保し直す) */
+static void reserve_work(nb_sim *s, int rk4)
+{
+    const size_t len = (size_t) s->n * (size_t) s->dim;
+    if (s->n > s->work_cap) {
+        s->a = grow(s->a, len);
+        s->work_cap = s->n;
+    }
+    if (rk4 && s->n > s->rk4_cap) {
+        s->rs = grow(s->rs, len);
+        s->vs = grow(s->vs, len);
+        s->sr = grow(s->sr, len);
+        s->sv = grow(s->sv, len);
+        s->rk4_cap = s->n;
+    }
+}
+
+/* 星の設定 ****************************************************************/
+void nb_set_star(nb_sim *s, int i, double m, const double *r, const double *v)
+{
+    s->m[i] = m;
+    for (int k = 0; k < s->dim; k++) {
+        s->r[i * s->dim + k] = r[k];
+        s->v[i * s->dim + k] = v[k];
+    }
+}
+
+void nb_set_accel(nb_sim *s, nb_accel_fn fn, void *arg)
+{
+    s->accel = fn;
+    s->accel_arg = arg;
+}
+
+/* 全ての組について足す ****************************************************/
+INLINE void accel_pairs(int dim, int n, double G, const double *m, const double *r, double *a)
+{
+    for (int i = 0; i < n; i++) {
+        double ai[dim];
+        for (int k = 0; k < dim; k++) ai[k] = 0.0;
+        if (m[i] != 0) {
+            for (int j = 0; j < n; j++) {
+                if (m[j] == 0 || i == j) continue;
+                double gap[dim], d2 = 0.0;
+                for (int k = 0; k < dim; k++) {
+                    gap[k] = r[j * dim + k] - r[i * dim + k];
+                    d2 += gap[k] * gap[k];
+                }
+                const double distance = sqrt(d2);
+                const double s = m[j] / pow(distance, 3);
+                for (int k = 0; k < dim; k++) ai[k] += gap[k] * s;
+            }
+        }
+        for (int k = 0; k < dim; k++) a[i * dim + k] = ai[k] * G;
+    }
+}
+
+void nb_accel(nb_sim *s, const double *r, double *a)
+{
+    if (s->accel != NULL) {
+        s->accel(s->accel_arg, s->n, s->m, r, a);
+        return;
+    }
+    switch (s->dim) {
+    case 2: accel_pairs(2, s->n, s->G, s->m, r, a); break;
+    case 3: accel_pairs(3, s->n, s->G, s->m, r, a); break;
+    default: accel_pairs(s->dim, s->n, s->G, s->m, r, a); break;
+    }
+}
+
+/* y += alpha * x **********************************************************/
+INLINE void axpy(int dim, int n, const double *m, double alpha, const double *x, double *y)
+{
+    for (int i = 0; i < n; i++) {
+        if (m != NULL && m[i] == 0) continue;
+        for (int k = 0; k < dim; k++) {
+            y[i * dim + k] += x[i * dim + k] * alpha;
+        }
+    }
+}
+
+void nb_axpy(int dim, int n, const double *m, double alpha, const double *x, double *y)
+{
+    switch (dim) {
+    case 2: axpy(2, n, m, alpha, x, y); break;
+    case 3: axpy(3, n, m, alpha, x, y); break;
+    default: axpy(dim, n, m, alpha, x, y); break;
+    }
+}
+
+/* ルンゲクッタ法の段 ******************************************************/
+INLINE void rk4_stage(int dim, int n, double c, double w, const double *r, const double *v,
+                      const double *a, double *rs, double *vs, double *sr, double *sv)
+{
+    for (int i = 0; i < n * dim; i += dim) {
+        for (int k = i; k < i + dim; k++) {
+            sr[k] += w * vs[k];
+            sv[k] += w * a[k];
+            rs[k] = r[k] + c * vs[k]; //vsを書き換える前に使う
+            vs[k] = v[k] + c * a[k];
+        }
+    }
+}
+
+void nb_rk4_stage(int dim, int n, double c, double w, const double *r, const double *v,
+                  const double *a, double *rs, double *vs, double *sr, double *sv)
+{
+    switch (dim) {
+    case 2: rk4_stage(2, n, c, w, r, v, a, rs, vs, sr, sv); break;
+    case 3: rk4_stage(3, n, c, w, r, v, a, rs, vs, sr, sv); break;
+    default: rk4_stage(dim, n, c, w, r, v, a, rs, vs, sr, sv); break;
+    }
+}
+
+INLINE void rk4_finish(int dim, int n, double h, const double *vs, const double *a,
+                       const double *sr, const double *sv, double *r, double *v)
+{
+    for (int i = 0; i < n * dim; i += dim) {
+        for (int k = i; k < i + dim; k++) {
+            r[k] += h * (sr[k] + vs[k]);
+            v[k] += h * (sv[k] + a[k]);
+        }
+    }
+}
+
+void nb_rk4_finish(int dim, int n, double h, const double *vs, const double *a,
+                   const double *sr, const double *sv, double *r, double *v)
+{
+    switch (dim) {
+    case 2: rk4_finish(2, n, h, vs, a, sr, sv, r, v); break;
+    case 3: rk4_finish(3, n, h, vs, a, sr, sv, r, v); break;
+    default: rk4_finish(dim, n, h, vs, a, sr, sv, r, v); break;
+    }
+}
+
+/* オイラー法 **************************************************************/
+void nb_step_euler(nb_sim *s, double dt)
+{
+    reserve_work(s, 0);
+    nb_accel(s, s->r, s->a);
+    nb_axpy(s->dim, s->n, s->m, dt, s->v, s->r); //速度はまだ更新する前
+    nb_axpy(s->dim, s->n, s->m, dt, s->a, s->v);
+}
+
+/*
+ * 四次のルンゲクッタ法
+ *   k1 = f(y), k2 = f(y + dt/2 k1), k3 = f(y + dt/2 k2), k4 = f(y + dt k3)
+ *   y += dt/6 (k1 + 2 k2 + 2 k3 + k4)
+ * y = (r, v), f = (v, a) として、傾きは段ごとに重みを掛けて (sr, sv) に足していく。
+ * 作業領域は星の数の5倍で、ステップの間で使い回す。
+ */
+void nb_step_rk4(nb_sim *s, double dt)
+{
+    const int dim = s->dim, n = s->n;
+    const size_t len = sizeof(double) * (size_t) n * (size_t) dim;
+
+    reserve_work(s, 1);
+    memset(s->sr, 0, len);
+    memset(s->sv, 0, len);
+    memcpy(s->vs, s->v, len);
+
+    nb_accel(s, s->r, s->a);
+    nb_rk4_stage(dim, n, dt / 2, 1.0, s->r, s->v, s->a, s->rs, s->vs, s->sr, s->sv);
+    nb_accel(s, s->rs, s->a);
+    nb_rk4_stage(dim, n, dt / 2, 2.0, s->r, s->v, s->a, s->rs, s->vs, s->sr, s->sv);
+    nb_accel(s, s->rs, s->a);
+    nb_rk4_stage(dim, n, dt, 2.0, s->r, s->v, s->a, s->rs, s->vs, s->sr, s->sv);
+    nb_accel(s, s->rs, s->a);
+    nb_rk4_finish(dim, n, dt / 6, s->vs, s->a, s->sr, s->sv, s->r, s->v);
+}
+
+/* 星の融合 ****************************************************************/
+int nb_merge_pairs(nb_sim *s, double R)
+{
+    const int dim = s->dim;
+    int i, j, k, merged = 0;
+
+    for (i = 0; i < s->n; i++) {
+        if (s->m[i] == 0) continue;
+        double *ri = &s->r[i * dim], *vi = &s->v[i * dim];
+        for (j = i + 1; j < s->n; j++) {
+            if (s->m[j] == 0) continue;
+            const double *rj = &s->r[j * dim], *vj = &s->v[j * dim];
+            double d2 = 0.0;
+            for (k = 0; k < dim; k++) d2 += (ri[k] - rj[k]) * (ri[k] - rj[k]);
+            if (sqrt(d2) >= R) continue;
+
+            //v = (m1 * v1 + m2 * v2) / (m1 + m2)
+            const double inv = 1 / (s->m[i] + s->m[j]);
+            for (k = 0; k < dim; k++) {
+                ri[k] = (ri[k] + rj[k]) * 0.5;
+                vi[k] = (vi[k] * s->m[i] + vj[k] * s->m[j]) * inv;
+            }
+            s->m[i] += s->m[j];
+            s->m[j] = 0;
+            merged++;
+        }
+    }
+    return merged;
+}
+
+/* ベクトルの表示 **********************************************************/
+void nb_print_vector(int dim, const double *x)
+{
+    printf("(%7.2f", x[0]);
+    for (int k = 1; k < dim; k++) {
+        printf(", %7.2f", x[k]);
+    }
+    printf(")");
+}
@@ -0,0 +1,97 @@
+#ifndef NBODY_H
+#define NBODY_H
+
+/*
+ * 多体計算の共通部分
+ * gravity1.c, gravity2.c (2次元), gravity3.c, gravity3_RK4.c (3次元) から共通で使う。
+ * 星の質量・座標・速度と、積分に使う作業領域を nb_sim 一つにまとめて持つ。
+ * グローバル変数を使わないので、いくつでも同時に計算できる。3次元で force.c を使うときは、
+ * 系ごとに別の force_param と force_ctx (力の計算の作業領域)を渡すこと(runner.c を参照)。
+ *
+ * 座標・速度・加速度は長さ n * dim の配列で、星iの成分kは r[i * dim + k] にある
+ * (dim = 3 なら double (*)[3] と同じ並び)。
+ *
+ * コンパイル: gcc -O2 gravity2.c nbody.c -lm
+ */
+
+/*
+ * 加速度を求める関数 (Gも掛けて a に書き込む)。
+ * 3次元で force.c を使うときに設定する。設定しなければ全ての組について足す。
+ */
+typedef void (*nb_accel_fn)(void *arg, int n, const double *m, const double *r, double *a);
+
+typedef struct {
+    int dim;   //2か3(それ以外でも動くが、速い版はない)
+    int n;     //星の数
+    int cap;   //確保してある星の数
+    double G;  //重力定数(組ごとに足すときだけ使う)
+    double *m;
+    double *r;
+    double *v;
+
+    nb_accel_fn accel; //NULLなら組ごとに足す
+    void *accel_arg;
+
+    //積分の作業領域(使うときに確保し、次のステップでも使い回す)
+    int work_cap;   //aの長さ(星の数)
+    int rk4_cap;    //rs, vs, sr, svの長さ(星の数)
+    double *a;      //加速度(RK4では各段の速度の傾き)
+    double *rs, *vs; //RK4の途中の段の座標と速度(速度は座標の傾きでもある)
+    double *sr, *sv; //RK4の傾きの重み付きの和
+} nb_sim;
+
+/* dim次元の空の系にする */
+void nb_init(nb_sim *s, int dim, double G);
+void nb_free(nb_sim *s);
+
+/* 星の数をnにする。元の星は残し、増えた分は0で埋める */
+void nb_resize(nb_sim *s, int n);
+
+/* i番目の星を設定する。r, v はdim個 */
+void nb_set_star(nb_sim *s, int i, double m, const double *r, const double *v);
+
+void nb_set_accel(nb_sim *s, nb_accel_fn fn, void *arg);
+
+/* 座標rでの全ての星の加速度をaに求める。質量0の星は0にする */
+void nb_accel(nb_sim *s, const double *r, double *a);
+
+/*
+ * オイラー法で dt だけ進める。更新する前の速度で座標を、更新する前の座標での加速度で速度を進める。
+ * 質量0の星(融合して消えた星)は動かさない。
+ */
+void nb_step_euler(nb_sim *s, double dt);
+
+/* 四次のルンゲクッタ法で dt だけ進める */
+void nb_step_rk4(nb_sim *s, double dt);
+
+/*
+ * 距離がR未満の組を融合する(O(N^2)、星の少ない2次元の系用)。
+ * 座標は中点, 速度は運動量を保存する値にし、吸収された星の質量を0にする。融合した数を返す。
+ */
+int nb_merge_pairs(nb_sim *s, double R);
+
+/* dim次元のベクトルを (x, y, ...) の形で表示する */
+void nb_print_vector(int dim, const double *x);
+
+/*
+ * 1つのループで済ませるベクトルの演算。n * dim 個の成分をその場で書き換える。
+ * 2次元と3次元は成分のループを展開した版を使う。
+ */
+
+/* y += alpha * x。m が NULL でなければ、質量0の星は飛ばす */
+void nb_axpy(int dim, int n, const double *m, double alpha, const double *x, double *y);
+
+/*
+ * ルンゲクッタ法の一つの段
+ * 今の段の傾き (vs, a) を重みwで (sr, sv) に足し、次の段の点
+ *   rs = r + c * vs,  vs = v + c * a
+ * を求める。
+ */
+void nb_rk4_stage(int dim, int n, double c, double w, const double *r, const double *v,
+                  const double *a, double *rs, double *vs, double *sr, double *sv);
+
+/* 最後の段の傾き (vs, a) も足して r += h * (sr + vs), v += h * (sv + a) とする */
+void nb_rk4_finish(int dim, int n, double h, const double *vs, const double *a,
+                   const double *sr, const double *sv, double *r, double *v);
+
+#endif
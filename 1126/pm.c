@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pm.h"
+#include "pool.h"
+
+#define LINE_CHUNK 16 //FFTで一度に取り出す1次元の列の数
+
+static void *grow(void *p, size_t size)
+{
+    p = realloc(p, size > 0 ? size : 1);
+    if (p == NULL) {
+        fprintf(stderr, "error: cannot allocate mesh.\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* 格子の番号 */
+static size_t cell(int ng, int ix, int iy, int iz)
+{
+    return ((size_t) ix * (size_t) ng + (size_t) iy) * (size_t) ng + (size_t) iz;
+}
+
+/* 初期化・解放 ************************************************************/
+int pm_init(pm *g, int ng, double box)
+{
+    int i, bits = 0;
+
+    memset(g, 0, sizeof(*g));
+    if (ng < 8 || (ng & (ng - 1)) != 0 || box <= 0) return -1;
+    while ((1 << bits) < ng) bits++;
+
+    const size_t M = (size_t) ng * ng * ng;
+    g->ng = ng;
+    g->box = box;
+    g->grid = (double *) grow(NULL, sizeof(double) * 2 * M);
+    for (int c = 0; c < 3; c++) {
+        g->acc[c] = (double *) grow(NULL, sizeof(double) * M);
+    }
+    g->green = (double *) grow(NULL, sizeof(double) * M);
+    g->twiddle = (double *) grow(NULL, sizeof(double) * (size_t) ng);
+    g->rev = (int *) grow(NULL, sizeof(int) * (size_t) ng);
+    g->start = (int *) grow(NULL, sizeof(int) * (size_t) (ng + 1));
+    g->fill = (int *) grow(NULL, sizeof(int) * (size_t) ng);
+
+    for (i = 0; i < ng / 2; i++) {
+        g->twiddle[2 * i] = cos(2 * M_PI * i / ng);
+        g->twiddle[2 * i + 1] = -sin(2 * M_PI * i / ng);
+    }
+    for (i = 0; i < ng; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        g->rev[i] = r;
+    }
+
+    //phi_k = -4 pi rho_k / k^2。窓関数では割らない(割ると格子の間隔程度の距離で力が振動する)。
+    //格子に配るのは質量なので密度にする 1/h^3 と、逆変換の規格化 1/ng^3 も掛けておく(合わせて 1/box^3)
+    double kk[ng];
+    for (i = 0; i < ng; i++) {
+        kk[i] = 2 * M_PI / box * (i <= ng / 2 ? i : i - ng);
+    }
+    for (int ix = 0; ix < ng; ix++) {
+        for (int iy = 0; iy < ng; iy++) {
+            for (int iz = 0; iz < ng; iz++) {
+                const double k2 = kk[ix] * kk[ix] + kk[iy] * kk[iy] + kk[iz] * kk[iz];
+                g->green[cell(ng, ix, iy, iz)] = k2 > 0 ? -4 * M_PI / k2 / (box * box * box) : 0.0;
+            }
+        }
+    }
+
+    //格子点に置いた質量1のポテンシャルを、隣の格子点まで(各方向のずれが0か1)求めておく
+    //phi(d) = sum_k green_k exp(i k d) で、逆変換と同じ向き
+    double c1[ng];
+    for (i = 0; i < ng; i++) {
+        c1[i] = cos(2 * M_PI * i / ng);
+    }
+    memset(g->self, 0, sizeof(g->self));
+    for (int ix = 0; ix < ng; ix++) {
+        for (int iy = 0; iy < ng; iy++) {
+            for (int iz = 0; iz < ng; iz++) {
+                const double gk = g->green[cell(ng, ix, iy, iz)];
+                for (int d = 0; d < 8; d++) {
+                    g->self[d] += gk * ((d & 4) ? c1[ix] : 1.0) * ((d & 2) ? c1[iy] : 1.0)
+                                     * ((d & 1) ? c1[iz] : 1.0);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+void pm_free(pm *g)
+{
+    free(g->grid);
+    for (int c = 0; c < 3; c++) {
+        free(g->acc[c]);
+    }
+    free(g->green);
+    free(g->twiddle);
+    free(g->rev);
+    free(g->line);
+    free(g->slab);
+    free(g->order);
+    free(g->start);
+    free(g->fill);
+    memset(g, 0, sizeof(*g));
+}
+
+/* 座標を箱の中に戻す ******************************************************/
+void pm_wrap(double box, double pos[3])
+{
+    for (int k = 0; k < 3; k++) {
+        pos[k] -= box * floor(pos[k] / box + 0.5);
+    }
+}
+
+/*
+ * CICの重み
+ * 格子点 i は座標 -box/2 + i * h にある。各方向について、posを挟む2つの格子点の番号と重みを求める。
+ */
+static void cic(const pm *g, const double pos[3], int idx[3][2], double w[3][2])
+{
+    const int ng = g->ng;
+    const double h = g->box / ng;
+    for (int k = 0; k < 3; k++) {
+        double u = (pos[k] + g->box / 2) / h;
+        u -= ng * floor(u / ng);
+        int i = (int) u;
+        const double f = u - i;
+        if (i >= ng) i -= ng; //丸めでちょうどngになったとき
+        idx[k][0] = i;
+        idx[k][1] = (i + 1) & (ng - 1);
+        w[k][0] = 1 - f;
+        w[k][1] = f;
+    }
+}
+
+/*
+ * 1次元のFFT (基数2, 時間間引き)
+ * a は長さnの複素数の列。inverseなら exp(+2 pi i k / n) で変換する(規格化はしない)。
+ */
+static void fft1d(double *a, int n, const double *tw, const int *rev, int inverse)
+{
+    for (int i = 0; i < n; i++) {
+        const int j = rev[i];
+        if (i < j) {
+            const double re = a[2 * i], im = a[2 * i + 1];
+            a[2 * i] = a[2 * j];
+            a[2 * i + 1] = a[2 * j + 1];
+            a[2 * j] = re;
+            a[2 * j + 1] = im;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        const int half = len / 2, step = n / len;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < half; k++) {
+                const double wr = tw[2 * k * step];
+                const double wi = inverse ? -tw[2 * k * step + 1] : tw[2 * k * step + 1];
+                double *u = &a[2 * (i + k)], *x = &a[2 * (i + k + half)];
+                const double tr = x[0] * wr - x[1] * wi;
+                const double ti = x[0] * wi + x[1] * wr;
+                x[0] = u[0] - tr;
+                x[1] = u[1] - ti;
+                u[0] += tr;
+                u[1] += ti;
+            }
+        }
+    }
+}
+
+/* 格子全体の仕事 **********************************************************/
+typedef struct {
+    pm *g;
+    int n;
+    const double *m;
+    const double (*r)[3];
+    int parity; //質量を配るときの、xの格子の番号の偶奇
+    int axis;   //FFTする方向
+    int inverse;
+    int counter;
+} pm_task;
+
+/* 格子を0にする(xの格子ごと) */
+static void clear_worker(void *arg, int tid, int nthreads)
+{
+    pm_task *task = (pm_task *) arg;
+    const int ng = task->g->ng;
+    const size_t plane = (size_t) ng * ng;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, ng, 1, &begin, &end)) {
+        memset(task->g->grid + 2 * plane * (size_t) begin, 0, sizeof(double) * 2 * plane * (size_t) (end - begin));
+    }
+}
+
+/*
+ * 質量を配る
+ * xの格子の番号がsの星はsとs + 1の面にだけ書くので、偶数のsどうし、奇数のsどうしは
+ * 同時に書いても重ならない。偶数と奇数の2回に分けて、面ごとにスレッドに配る。
+ */
+static void deposit_worker(void *arg, int tid, int nthreads)
+{
+    pm_task *task = (pm_task *) arg;
+    pm *g = task->g;
+    const int ng = g->ng;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, ng / 2, 1, &begin, &end)) {
+        for (int h = begin; h < end; h++) {
+            const int s = 2 * h + task->parity;
+            for (int q = g->start[s]; q < g->start[s + 1]; q++) {
+                const int i = g->order[q];
+                int idx[3][2];
+                double w[3][2];
+                cic(g, task->r[i], idx, w);
+                for (int a = 0; a < 2; a++) {
+                    for (int b = 0; b < 2; b++) {
+                        for (int c = 0; c < 2; c++) {
+                            g->grid[2 * cell(ng, idx[0][a], idx[1][b], idx[2][c])] +=
+                                task->m[i] * w[0][a] * w[1][b] * w[2][c];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* axisの方向の1次元の列を取り出してFFTする(ng^2本) */
+static void fft_worker(void *arg, int tid, int nthreads)
+{
+    pm_task *task = (pm_task *) arg;
+    pm *g = task->g;
+    const int ng = g->ng;
+    const size_t stride = task->axis == 0 ? (size_t) ng * ng : (task->axis == 1 ? (size_t) ng : 1);
+    double *line = g->line + (size_t) tid * 2 * ng;
+    int begin, end;
+    (void) nthreads;
+    while (pool_next(&task->counter, ng * ng, LINE_CHUNK, &begin, &end)) {
+        for (int l = begin; l < end; l++) {
+            const int p = l / ng, q = l % ng;
+            //列の先頭: zの列は (p, q, 0), yの列は (p, 0, q), xの列は (0, p, q)
+            const size_t base = task->axis == 2 ? cell(ng, p, q, 0)
+                              : (task->axis == 1 ? cell(ng, p, 0, q) : cell(ng, 0, p, q));
+            for (int i = 0; i < ng; i++) {
+                line[2 * i] = g->grid[2 * (base + i * stride)];
+                line[2 * i + 1] = g->grid[2 * (base + i * stride) + 1];
+            }
+            fft1d(line, ng, g->twiddle, g->rev, task->inverse);
+            for (int i = 0; i < ng; i++) {
+                g->grid[2 * (base + i * stride)] = line[2 * i];
+                g->grid[2 * (base + i * stride) + 1] = line[2 * i + 1];
+            }
+        }
+    }
+}
+
+static void fft3d(pm *g, int inverse)
+{
+    for (int axis = 2; axis >= 0; axis--) {
+        pm_task task = {g, 0, NULL, NULL, 0, axis, inverse, 0};
+        pool_run(fft_worker, &task);
+    }
+}
+
+/* 波数ごとに係数を掛ける */
+static void green_worker(void *arg, int tid, int nthreads)
+{
+    pm_task *task = (pm_task *) arg;
+    pm *g = task->g;
+    const size_t plane = (size_t) g->ng * g->ng;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, g->ng, 1, &begin, &end)) {
+        for (size_t c = plane * (size_t) begin; c < plane * (size_t) end; c++) {
+            g->grid[2 * c] *= g->green[c];
+            g->grid[2 * c + 1] *= g->green[c];
+        }
+    }
+}
+
+/* ポテンシャルの4点差分で格子点の加速度を求める a = -grad phi */
+static void gradient_worker(void *arg, int tid, int nthreads)
+{
+    pm_task *task = (pm_task *) arg;
+    pm *g = task->g;
+    const int ng = g->ng, mask = ng - 1;
+    const double inv = 1.0 / (12 * g->box / ng);
+    const double *phi = g->grid;
+    int begin, end;
+    (void) tid;
+    (void) nthreads;
+    while (pool_next(&task->counter, ng, 1, &begin, &end)) {
+        for (int ix = begin; ix < end; ix++) {
+            for (int iy = 0; iy < ng; iy++) {
+                for (int iz = 0; iz < ng; iz++) {
+                    const size_t c = cell(ng, ix, iy, iz);
+#define PHI(x, y, z) phi[2 * cell(ng, (x) & mask, (y) & mask, (z) & mask)]
+                    g->acc[0][c] = -(8 * (PHI(ix + 1, iy, iz) - PHI(ix - 1, iy, iz))
+                                   - (PHI(ix + 2, iy, iz) - PHI(ix - 2, iy, iz))) * inv;
+                    g->acc[1][c] = -(8 * (PHI(ix, iy + 1, iz) - PHI(ix, iy - 1, iz))
+                                   - (PHI(ix, iy + 2, iz) - PHI(ix, iy - 2, iz))) * inv;
+                    g->acc[2][c] = -(8 * (PHI(ix, iy, iz + 1) - PHI(ix, iy, iz - 1))
+                                   - (PHI(ix, iy, iz + 2) - PHI(ix, iy, iz - 2))) * inv;
+#undef PHI
+                }
+            }
+        }
+    }
+}
+
+/* 格子で解く **************************************************************/
+void pm_solve(pm *g, int n, const double *m, const double (*r)[3])
+{
+    const int ng = g->ng;
+    int i;
+
+    if (n > g->cap) {
+        g->slab = (int *) grow(g->slab, sizeof(int) * (size_t) n);
+        g->order = (int *) grow(g->order, sizeof(int) * (size_t) n);
+        g->cap = n;
+    }
+    if (pool_size() > g->nline) {
+        g->line = (double *) grow(g->line, sizeof(double) * 2 * (size_t) ng * (size_t) pool_size());
+        g->nline = pool_size();
+    }
+
+    //xの格子の番号で星を数え分ける(質量を配るときに面ごとに分けるため)
+    memset(g->start, 0, sizeof(int) * (size_t) (ng + 1));
+    for (i = 0; i < n; i++) {
+        int idx[3][2];
+        double w[3][2];
+        if (m[i] == 0) {
+            g->slab[i] = -1;
+            continue;
+        }
+        cic(g, r[i], idx, w);
+        g->slab[i] = idx[0][0];
+        g->start[idx[0][0] + 1]++;
+    }
+    for (i = 0; i < ng; i++) {
+        g->start[i + 1] += g->start[i];
+    }
+    memcpy(g->fill, g->start, sizeof(int) * (size_t) ng);
+    for (i = 0; i < n; i++) {
+        if (g->slab[i] >= 0) g->order[g->fill[g->slab[i]]++] = i;
+    }
+
+    pm_task task = {g, n, m, r, 0, 0, 0, 0};
+    pool_run(clear_worker, &task);
+    for (int parity = 0; parity < 2; parity++) {
+        task.parity = parity;
+        task.counter = 0;
+        pool_run(deposit_worker, &task);
+    }
+
+    fft3d(g, 0);
+    task.counter = 0;
+    pool_run(green_worker, &task);
+    fft3d(g, 1);
+
+    task.counter = 0;
+    pool_run(gradient_worker, &task);
+}
+
+/* 補間 ********************************************************************/
+void pm_accel_at(const pm *g, const double pos[3], double a[3])
+{
+    int idx[3][2];
+    double w[3][2];
+
+    cic(g, pos, idx, w);
+    a[0] = a[1] = a[2] = 0.0;
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < 2; k++) {
+                const size_t c = cell(g->ng, idx[0][i], idx[1][j], idx[2][k]);
+                const double wt = w[0][i] * w[1][j] * w[2][k];
+                a[0] += wt * g->acc[0][c];
+                a[1] += wt * g->acc[1][c];
+                a[2] += wt * g->acc[2][c];
+            }
+        }
+    }
+}
+
+double pm_potential_at(const pm *g, const double pos[3])
+{
+    int idx[3][2];
+    double w[3][2];
+    double phi = 0.0;
+
+    cic(g, pos, idx, w);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < 2; k++) {
+                phi += w[0][i] * w[1][j] * w[2][k] * g->grid[2 * cell(g->ng, idx[0][i], idx[1][j], idx[2][k])];
+            }
+        }
+    }
+    return phi;
+}
+
+double pm_self_potential(const pm *g, const double pos[3])
+{
+    int idx[3][2];
+    double w[3][2], pair[3][2];
+    double phi = 0.0;
+
+    //配った8点と補間する8点の組を、各方向で同じ点(ずれ0)か隣の点(ずれ1)かでまとめる
+    cic(g, pos, idx, w);
+    for (int k = 0; k < 3; k++) {
+        pair[k][0] = w[k][0] * w[k][0] + w[k][1] * w[k][1];
+        pair[k][1] = 2 * w[k][0] * w[k][1];
+    }
+    for (int d = 0; d < 8; d++) {
+        phi += pair[0][(d >> 2) & 1] * pair[1][(d >> 1) & 1] * pair[2][d & 1] * g->self[d];
+    }
+    return phi;
+}
@@ -0,0 +1,56 @@
+#ifndef PM_H
+#define PM_H
+
+/*
+ * 周期境界のParticle-Mesh法
+ * 一辺 box の立方体 [-box/2, box/2)^3 が全ての方向に繰り返している系の重力を、一辺 ng 個の格子で求める。
+ *   1. 星の質量をCIC (cloud-in-cell) で周りの8個の格子点に配る
+ *   2. 密度をFFTして、波数空間でポアソン方程式を解く (phi_k = -4 pi rho_k / k^2)。
+ *      平均の密度は引く(k = 0 を0にする)
+ *   3. ポテンシャルの4点差分で格子点の加速度を求め、星の位置にCICで補間する
+ * 1ステップは O(N + M log M) (M = ng^3)。格子の間隔より近い星の力は弱められる。
+ * FFTは自前の基数2のもので、格子の数は2の累乗に限る。各段はスレッドプールで並列に行う。
+ */
+
+typedef struct {
+    int ng;          //一辺の格子の数(2の累乗, 8以上)
+    double box;      //周期の長さ
+    double *grid;    //複素数の格子 (ng^3個, 実部と虚部を交互に)。密度を配り、解いた後はポテンシャル
+    double *acc[3];  //格子点の加速度
+    double *green;   //波数ごとに掛ける係数(1/ng^3の規格化も含む)
+    double self[8];  //格子点に置いた質量1の、各方向に0か1だけずれた格子点でのポテンシャル(番号はdx*4+dy*2+dz)
+    double *twiddle; //FFTの回転因子 exp(-2 pi i k / ng) (ng / 2個)
+    int *rev;        //ビット反転した番号
+    double *line;    //スレッドごとの1次元FFTの作業領域
+    int nline;       //作業領域を持っているスレッドの数
+    int *slab;       //星ごとのx方向の格子の番号
+    int *order;      //xの格子の番号の順に並べた星
+    int *start;      //xの格子の番号ごとのorderの始まり (ng + 1個)
+    int *fill;       //orderに並べるときの、xの格子の番号ごとの次の位置 (ng個)
+    int cap;         //星の数の上限
+} pm;
+
+/* 格子の数が2の累乗で8以上でなければ-1を返す */
+int pm_init(pm *g, int ng, double box);
+void pm_free(pm *g);
+
+/*
+ * 全ての星の質量を格子に配り、ポテンシャルと格子点の加速度(G = 1)を求める。
+ * 質量0の星は配らない。星の座標は箱の外にあってもよい(周期で箱の中に戻して扱う)。
+ */
+void pm_solve(pm *g, int n, const double *m, const double (*r)[3]);
+
+/* pm_solveの後で、点posでの加速度とポテンシャルを格子から補間する */
+void pm_accel_at(const pm *g, const double pos[3], double a[3]);
+double pm_potential_at(const pm *g, const double pos[3]);
+
+/*
+ * posに置いた質量1の星が自分自身に及ぼすポテンシャル(CICで配って補間した分)。
+ * pm_potential_atはこれも含むので、エネルギーを測るときは m * pm_self_potential を引く。
+ */
+double pm_self_potential(const pm *g, const double pos[3]);
+
+/* 座標を箱 [-box/2, box/2) の中に戻す */
+void pm_wrap(double box, double pos[3]);
+
+#endif
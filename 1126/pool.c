@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+static int nworker = 1;
+static pthread_t *threads;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER; //仕事が来た
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER; //全員が終わった
+static unsigned long generation = 0; //pool_runを呼んだ回数
+static unsigned long start_generation = 0; //プールを始めたときのgeneration
+static int running = 0; //まだ終わっていない作業者の数
+static int quit = 0;
+static pool_fn job_fn;
+static void *job_arg;
+
+/* 作業者のスレッド ********************************************************/
+static void *worker(void *p)
+{
+    const int tid = (int) (long) p;
+    unsigned long seen = start_generation; //作られる前の仕事はやらない
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        while (generation == seen && !quit) {
+            pthread_cond_wait(&wake, &lock);
+        }
+        if (quit) {
+            pthread_mutex_unlock(&lock);
+            return NULL;
+        }
+        seen = generation;
+        const pool_fn fn = job_fn;
+        void *arg = job_arg;
+        pthread_mutex_unlock(&lock);
+
+        fn(arg, tid, nworker);
+
+        pthread_mutex_lock(&lock);
+        if (--running == 0) {
+            pthread_cond_signal(&done);
+        }
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+/* 開始・終了 **************************************************************/
+void pool_start(int nthreads)
+{
+    if (nthreads < 1) nthreads = 1;
+    pool_stop();
+    nworker = nthreads;
+    quit = 0;
+    start_generation = generation;
+    if (nworker == 1) return;
+
+    threads = (pthread_t *) malloc(sizeof(pthread_t) * (size_t) nworker);
+    if (threads == NULL) {
+        fprintf(stderr, "error: cannot allocate threads.\n");
+        exit(1);
+    }
+    for (int t = 1; t < nworker; t++) {
+        if (pthread_create(&threads[t], NULL, worker, (void *) (long) t) != 0) {
+            fprintf(stderr, "error: cannot create thread.\n");
+            exit(1);
+        }
+    }
+}
+
+void pool_stop()
+{
+    if (threads == NULL) return;
+
+    pthread_mutex_lock(&lock);
+    quit = 1;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+    for (int t = 1; t < nworker; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+    threads = NULL;
+    nworker = 1;
+}
+
+int pool_size()
+{
+    return nworker;
+}
+
+/* 仕事の実行 **************************************************************/
+void pool_run(pool_fn fn, void *arg)
+{
+    if (nworker == 1) {
+        fn(arg, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    job_fn = fn;
+    job_arg = arg;
+    running = nworker - 1;
+    generation++;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    fn(arg, 0, nworker);
+
+    pthread_mutex_lock(&lock);
+    while (running > 0) {
+        pthread_cond_wait(&done, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+int pool_next(int *counter, int n, int chunk, int *begin, int *end)
+{
+    const int b = __atomic_fetch_add(counter, chunk, __ATOMIC_RELAXED);
+    if (b >= n) return 0;
+    *begin = b;
+    *end = b + chunk < n ? b + chunk : n;
+    return 1;
+}
@@ -0,0 +1,27 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * 力の計算に使うスレッドプール
+ * スレッドは最初に一度だけ作り、pool_runのたびに起こして同じ仕事を並列に実行させる。
+ * 呼び出したスレッドも番号0の作業者として働く。
+ */
+
+/* tidは0からnthreads - 1までの作業者の番号 */
+typedef void (*pool_fn)(void *arg, int tid, int nthreads);
+
+/* nthreads個の作業者でプールを始める(1なら新しいスレッドは作らない) */
+void pool_start(int nthreads);
+void pool_stop();
+int pool_size();
+
+/* 全ての作業者でfn(arg, tid, nthreads)を実行し、全員が終わるまで待つ */
+void pool_run(pool_fn fn, void *arg);
+
+/*
+ * 0からn - 1までの仕事を chunk 個ずつ取り出す。pool_runの中から使う。
+ * *counterは最初に0にしておくこと。取り出した範囲は[*begin, *end)、残っていなければ0を返す。
+ */
+int pool_next(int *counter, int n, int chunk, int *begin, int *end);
+
+#endif
@@ -0,0 +1,876 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "runner.h"
+#include "force.h"
+#include "direct.h"
+#include "pool.h"
+#include "blockstep.h"
+#include "integrator.h"
+#include "collide.h"
+#include "initcond.h"
+#include "snapshot.h"
+#include "asyncout.h"
+#include "diag.h"
+#include "checkpoint.h"
+#include "liveview.h"
+#include "pm.h"
+
+#define WIDTH 75
+#define HEIGHT 50
+#define ZRANGE 1
+
+#define VECTORSIZE 3 //n次元の系
+
+static const double R = 1.0; // 融合する際の閾値半径
+static const double G = 1.0; // gravity constant
+
+struct star //初期条件とチェックポイントでの並び
+{
+    double m; // mass
+    double r[VECTORSIZE]; // position
+    double v[VECTORSIZE]; // velocity
+};
+
+static const struct star default_stars[] = { //-fを指定しないときの星
+    { 800.0, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0} },
+    { 800.0, {-10.0, 0.0, 0.0}, {0.0, 0.0, 0.0}}
+};
+
+#if VECTORSIZE != 3
+#error "force.c は3次元専用"
+#endif
+
+/* 一つの計算の状態(runner_mainの中だけで使う) */
+typedef struct {
+    const runner_method *method; //-iや-bを指定しないときの積分法
+    nb_sim sim; //星の質量, 座標, 速度と積分の作業領域
+    int *star_id; //星の元の番号(消えた星を詰めても、出力には元の番号を使う)
+    int ndead; //まだ詰めていない消えた星の数
+    FILE *fp; //絵を描くときの出力先(space.txt)
+    snap_writer snap; //-oを指定したときのスナップショットの出力先
+    int use_snap;
+    out_writer writer; //出力のスレッド
+    diag_log diag; //-Dを指定したときの保存量のログ
+    int use_diag;
+    live_view view; //-vを指定したときのgnuplotの表示
+    int use_view;
+    ckpt_reader ckpt; //-rを指定したときに読むチェックポイント
+    int headless; //-Hを指定したら、絵を描かず待たずに計算だけする
+    force_param force; //加速度の計算方法
+    force_ctx fctx; //力の計算の作業領域
+    blockstep block; //ブロック時間刻み(-bを指定したときに使う)
+    integrator integ; //シンプレクティック積分法(-iを指定したときに使う)
+    int use_integ;
+    collider coll; //融合する星を探す空間ハッシュ
+    int nerror; //力の誤差を測った回数(-Hのときは最後にまとめて表示する)
+    double error_sum2, error_max; //測った誤差のrmsの二乗の和と、最大値
+    double error_time; //誤差を測るのにかかった時間
+} runner;
+
+/***************************************************************************/
+static void plot_stars(FILE *fp, const out_frame *f);
+static void update_positions(runner *run, const double dt); //-iや-bを指定しないときの積分法で更新
+static void update_block(runner *run); //ブロック時間刻みでdtだけ進める
+static void update_symplectic(runner *run, const double dt); //シンプレクティック積分法で更新
+static void wrap_stars(runner *run); //PMのとき箱から出た星を箱の中に戻す
+static int merge_stars(runner *run); //近づいた星を融合する
+static void compact_stars(runner *run); //融合して消えた星を詰める
+static void usage(const char *prog, const runner_method *method);
+static int load_stars(runner *run, const char *path); //初期条件をファイルから読む
+static void set_stars(runner *run, const struct star *s, const int n); //星を計算用の配列に写す
+static void accel_force(void *arg, int n, const double *m, const double *r, double *a); //force.cで加速度を求める
+static void output_point(runner *run, const double t, const long step); //出力する時刻ごとに呼ぶ
+static void capture_frame(runner *run, const double t, const long step); //星の状態を出力のスレッドに渡す
+static void output_frame(const out_frame *f, void *arg); //出力のスレッドで書き出す
+static int measure_force_error(runner *run, double *rms, double *max); //測ったら1を返す
+static void measure_diag(runner *run, out_frame *f); //保存量を測る
+static void report_run(runner *run, const long steps, const double wall); //実行の速さを表示
+static int save_checkpoint(runner *run, const char *path, const double t, const long step, const double dt, const int mode);
+static int restore_stars(runner *run); //チェックポイントから星を読む
+static int restore_run(runner *run, double *t, long *step, const double dt, const int mode); //時刻と積分法の状態を読む
+static FILE *gnuplot_open(); //gnuplotを開く
+static void gnuplot_close(FILE *gp); //gnuplotを閉じる
+static void view_stars(runner *run); //星の座標をgnuplotの表示のスレッドに渡す
+
+
+/**************************************************************************/
+int runner_main(int argc, char* argv[], const runner_method *method)
+{
+    const char *filename = "space.txt";
+    FILE *gp;
+    runner ctx;
+    runner *run = &ctx;
+
+    memset(run, 0, sizeof(*run));
+    run->method = method;
+    force_init(&run->force, G, &run->fctx);
+
+    static const struct option long_options[] = {
+        {"solver", required_argument, NULL, 's'},
+        {"theta",  required_argument, NULL, 't'},
+        {"eps",    required_argument, NULL, 'e'},
+        {"order",  required_argument, NULL, 'p'},
+        {"simd",   required_argument, NULL, 'S'},
+        {"threads", required_argument, NULL, 'j'},
+        {"symmetric", no_argument,     NULL, 'y'},
+        {"precision", required_argument, NULL, 'P'},
+        {"grid",   required_argument, NULL, 'g'},
+        {"box",    required_argument, NULL, 'B'},
+        {"block",  required_argument, NULL, 'b'},
+        {"levels", required_argument, NULL, 'L'},
+        {"integrator", required_argument, NULL, 'i'},
+        {"input",  required_argument, NULL, 'f'},
+        {"output", required_argument, NULL, 'o'},
+        {"dt",     required_argument, NULL, 'd'},
+        {"stop",   required_argument, NULL, 'T'},
+        {"interval", required_argument, NULL, 'n'},
+        {"headless", no_argument,     NULL, 'H'},
+        {"diag",   required_argument, NULL, 'D'},
+        {"checkpoint", required_argument, NULL, 'c'},
+        {"checkpoint-every", required_argument, NULL, 'C'},
+        {"restart", required_argument, NULL, 'r'},
+        {"view",   required_argument, NULL, 'v'},
+        {"help",   no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt, nthreads = 1, levels = 12;
+    const char *input = NULL, *output = NULL, *diag_path = NULL;
+    const char *checkpoint = NULL, *restart = NULL;
+    long ckpt_every = 1000;
+    double fps = 0.0;
+    double eta = 0.0, dt = 0.1, stop_time = 400;
+    int interval = 10;
+    while ((opt = getopt_long(argc, argv, "s:t:e:p:S:j:yP:g:B:b:L:i:f:o:d:T:n:HD:c:C:r:v:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            if (force_parse_solver(optarg) < 0) {
+                fprintf(stderr, "error: unknown solver %s.\n", optarg);
+                return 1;
+            }
+            run->force.solver = (solver_type) force_parse_solver(optarg);
+            break;
+        case 't':
+            run->force.theta = atof(optarg);
+            break;
+        case 'e':
+            run->force.eps = atof(optarg);
+            break;
+        case 'p':
+            run->force.order = atoi(optarg);
+            break;
+        case 'S': {
+            const int isa = direct_parse_simd(optarg);
+            if (isa < 0) {
+                fprintf(stderr, "error: unknown instruction set %s.\n", optarg);
+                return 1;
+            }
+            if ((int) direct_set_simd((simd_type) isa) != isa && isa != SIMD_AUTO) {
+                fprintf(stderr, "warning: %s is not supported on this cpu.\n", optarg);
+            }
+            break;
+        }
+        case 'j':
+            nthreads = atoi(optarg);
+            break;
+        case 'y':
+            run->force.symmetric = 1;
+            break;
+        case 'P':
+            if (strcmp(optarg, "double") == 0) {
+                run->force.mixed = 0;
+            } else if (strcmp(optarg, "mixed") == 0) {
+                run->force.mixed = 1;
+            } else {
+                fprintf(stderr, "error: unknown precision %s.\n", optarg);
+                return 1;
+            }
+            break;
+        case 'g':
+            run->force.grid = atoi(optarg);
+            if (run->force.grid < 8 || (run->force.grid & (run->force.grid - 1)) != 0) {
+                fprintf(stderr, "error: grid size must be a power of two (>= 8).\n");
+                return 1;
+            }
+            break;
+        case 'B':
+            run->force.box = atof(optarg);
+            if (run->force.box <= 0) {
+                fprintf(stderr, "error: box size must be positive.\n");
+                return 1;
+            }
+            break;
+        case 'b':
+            eta = atof(optarg);
+            break;
+        case 'L':
+            levels = atoi(optarg);
+            break;
+        case 'i':
+            if (strcmp(optarg, method->name) == 0) {
+                run->use_integ = 0;
+                break;
+            }
+            if (integ_parse(optarg) < 0) {
+                fprintf(stderr, "error: unknown integrator %s.\n", optarg);
+                return 1;
+            }
+            integ_init(&run->integ, (integrator_type) integ_parse(optarg));
+            run->use_integ = 1;
+            break;
+        case 'f':
+            input = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'd':
+            dt = atof(optarg);
+            break;
+        case 'T':
+            stop_time = atof(optarg);
+            break;
+        case 'n':
+            interval = atoi(optarg);
+            if (interval < 1) {
+                fprintf(stderr, "error: interval must be positive.\n");
+                return 1;
+            }
+            break;
+        case 'H':
+            run->headless = 1;
+            break;
+        case 'D':
+            diag_path = optarg;
+            break;
+        case 'c':
+            checkpoint = optarg;
+            break;
+        case 'C':
+            ckpt_every = atol(optarg);
+            if (ckpt_every < 1) {
+                fprintf(stderr, "error: checkpoint interval must be positive.\n");
+                return 1;
+            }
+            break;
+        case 'r':
+            restart = optarg;
+            break;
+        case 'v':
+            fps = atof(optarg);
+            break;
+        default:
+            usage(argv[0], run->method);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    //PMは一部の星だけを求めるときも格子全体を解き直すので、ブロック時間刻みの細かい段ごとに全体を解くことになる
+    if (eta > 0 && run->force.solver == SOLVER_PM) {
+        fprintf(stderr, "warning: pm solves the whole mesh on every block substep; "
+                "use a shared step (without -b) unless the mesh is small.\n");
+    }
+
+    pool_start(nthreads); //RK4の各段でも同じスレッドを使い回す
+
+    nb_init(&run->sim, VECTORSIZE, G);
+    nb_set_accel(&run->sim, accel_force, &run->force);
+    if (restart != NULL) {
+        if (ckpt_open(&run->ckpt, restart) != 0) {
+            return 1;
+        }
+        if (restore_stars(run) != 0) {
+            fprintf(stderr, "error: cannot restore stars from %s.\n", restart);
+            return 1;
+        }
+    } else if (input != NULL) {
+        if (load_stars(run, input) != 0) {
+            return 1;
+        }
+    } else {
+        set_stars(run, default_stars, sizeof(default_stars) / sizeof(struct star));
+    }
+    int i;
+
+    gp = NULL;
+    if (fps > 0) {
+        if ((gp = gnuplot_open()) == NULL) {
+            return 1;
+        }
+        lv_start(&run->view, gp, fps);
+        run->use_view = 1;
+    }
+
+    if (!run->headless && (run->fp = fopen(filename, "a")) == NULL) {
+        fprintf(stderr, "error: cannot open %s.\n", filename);
+        return 1;
+    }
+    if (output != NULL) {
+        if (snap_open(&run->snap, output) != 0) {
+            return 1;
+        }
+        run->use_snap = 1;
+    }
+    if (diag_path != NULL) {
+        if (diag_open(&run->diag, diag_path, restart != NULL) != 0) {
+            return 1;
+        }
+        run->use_diag = 1;
+    }
+    out_start(&run->writer, 4, output_frame, run);
+
+    if (run->star_id == NULL) { //チェックポイントから読んだときは元の番号も読んである
+        run->star_id = (int *) malloc(sizeof(int) * (size_t) (run->sim.n > 0 ? run->sim.n : 1));
+        if (run->star_id == NULL) {
+            fprintf(stderr, "error: cannot allocate stars.\n");
+            return 1;
+        }
+        for (i = 0; i < run->sim.n; i++) {
+            run->star_id[i] = i;
+        }
+    }
+
+    if(optind < argc) {
+        dt = atof(argv[optind]);
+    }
+    block_init(&run->block, dt, levels, eta);
+    collide_init(&run->coll);
+
+    const int mode = eta > 0 ? 2 : run->use_integ; //チェックポイントと同じ積分法か確かめる
+    double t = 0;
+    long step = 0;
+    if (restart != NULL) {
+        if (restore_run(run, &t, &step, dt, mode) != 0) {
+            fprintf(stderr, "error: cannot resume from %s with these settings.\n", restart);
+            return 1;
+        }
+    }
+    const long first_step = step;
+
+    //保存量のずれは計算を始める前の値から測る。再開したときはチェックポイントに残した値を使う
+    //(前の実行で-Dを指定していなかったときだけ、再開した時点の値から測る)
+    if (run->use_diag) {
+        diag_state d0;
+        if (restart == NULL || ckpt_read(&run->ckpt, "diag", &d0, sizeof(d0)) != 0) {
+            diag_measure(&run->force, run->sim.n, run->sim.m, (const double (*)[3]) run->sim.r, (const double (*)[3]) run->sim.v, &d0);
+        }
+        diag_start(&run->diag, &d0);
+    }
+    if (restart != NULL) {
+        ckpt_close(&run->ckpt);
+    }
+    //初期条件も一枚目として出力する(再開したときは前の実行で出力してある)
+    if (restart == NULL) {
+        output_point(run, t, step);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = (int) step; t <= stop_time; i++, t += dt) {
+        if (eta > 0) {
+            update_block(run);
+        } else if (run->use_integ) {
+            update_symplectic(run, dt);
+        } else {
+            update_positions(run, dt);
+        }
+        if (run->use_view && lv_wants(&run->view)) {
+            view_stars(run); //送るのは別のスレッドで、間に合わなければ古いフレームを捨てる
+        }
+        //フレームはステップを進めた後の状態なので、時刻とステップも進めた後の値を付ける
+        if ((i + 1) % interval == 0) {
+            output_point(run, t + dt, i + 1);
+        }
+        if (checkpoint != NULL && (i + 1) % ckpt_every == 0) {
+            save_checkpoint(run, checkpoint, t + dt, i + 1, dt, mode); //失敗しても計算は続ける
+        }
+    }
+    out_stop(&run->writer); //残りのフレームを書き終えるまで待つ
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (run->headless) {
+        report_run(run, i - first_step, (double) (end.tv_sec - start.tv_sec) + 1e-9 * (double) (end.tv_nsec - start.tv_nsec));
+    }
+
+    if (eta > 0) {
+        printf("block timesteps: %ld force evaluations in %ld substeps "
+               "(shared smallest step: %ld)\n", run->block.nforce, run->block.nsub, run->block.nshared);
+    } else if (run->use_integ) {
+        printf("%s: %ld force evaluations\n", integ_name(run->integ.type), run->integ.nforce);
+        integ_free(&run->integ);
+    }
+
+    if (run->use_snap && snap_close(&run->snap) != 0) {
+        return 1;
+    }
+    if (run->use_diag && diag_close(&run->diag) != 0) {
+        fprintf(stderr, "error: cannot write %s.\n", diag_path);
+        return 1;
+    }
+
+    pool_stop();
+    block_free(&run->block);
+    collide_free(&run->coll);
+    nb_free(&run->sim);
+    force_ctx_free(&run->fctx);
+    free(run->star_id);
+    if (run->fp != NULL) {
+        fclose(run->fp);
+    }
+    if (run->use_view) {
+        lv_stop(&run->view);
+        gnuplot_close(gp);
+        fprintf(stderr, "view: %ld frames sent, %ld dropped\n", run->view.nsent, run->view.ndropped);
+    }
+    return 0;
+}
+
+/* 使い方 ******************************************************************/
+static void usage(const char *prog, const runner_method *method)
+{
+    fprintf(stderr, "usage: %s [options] [dt]\n", prog);
+    fprintf(stderr, "  -s, --solver=NAME  加速度の計算方法 (direct, bh, fmm, pm)\n");
+    fprintf(stderr, "  -t, --theta=THETA  Barnes-Hut, FMMの開き角 (既定値 0.5)\n");
+    fprintf(stderr, "  -e, --eps=EPS      Plummerソフトニング長 (既定値 0)\n");
+    fprintf(stderr, "  -p, --order=P      FMMの展開の次数 (既定値 4, 最大 10)\n");
+    fprintf(stderr, "  -S, --simd=ISA     直接計算の命令セット (auto, scalar, avx2, avx512)\n");
+    fprintf(stderr, "  -j, --threads=N    力の計算に使うスレッドの数 (既定値 1)\n");
+    fprintf(stderr, "  -y, --symmetric    直接計算で作用反作用を使い、組の計算を半分にする\n");
+    fprintf(stderr, "  -P, --precision=MODE 直接計算の精度 (double, mixed: 組ごとは単精度で和は倍精度)\n");
+    fprintf(stderr, "  -g, --grid=NG      PMの一辺の格子の数 (2の累乗, 既定値 64)\n");
+    fprintf(stderr, "  -B, --box=L        PMの周期の箱の一辺 (箱は [-L/2, L/2)^3, 既定値 100)\n");
+    fprintf(stderr, "  -b, --block=ETA    星ごとのブロック時間刻みを使う (dt = ETA * |a| / |j|, 目安 0.02)\n");
+    fprintf(stderr, "  -L, --levels=L     ブロック時間刻みの一番短い刻みを dt / 2^L にする (既定値 12)\n");
+    fprintf(stderr, "  -f, --input=FILE   初期条件を読む (CSV: m,x,y,z,vx,vy,vz またはバイナリ)\n");
+    fprintf(stderr, "  -o, --output=FILE  座標と速度をバイナリのスナップショットに書く (space.txtには書かない)\n");
+    fprintf(stderr, "  -d, --dt=DT        時間刻み (既定値 0.1, 最後の引数でも指定できる)\n");
+    fprintf(stderr, "  -T, --stop=TIME    終わりの時刻 (既定値 400)\n");
+    fprintf(stderr, "  -n, --interval=K   Kステップごとに出力する (既定値 10)\n");
+    fprintf(stderr, "  -D, --diag=FILE    出力のたびにエネルギー, 運動量, 角運動量とそのずれをFILEに書く\n");
+    fprintf(stderr, "  -c, --checkpoint=FILE  計算の状態をFILEに書く(一時ファイルに書いてから置き換える)\n");
+    fprintf(stderr, "  -C, --checkpoint-every=K  Kステップごとにチェックポイントを書く (既定値 1000)\n");
+    fprintf(stderr, "  -r, --restart=FILE チェックポイントから再開する (dt, 積分法, 力の計算の設定は書いたときと同じにすること)\n");
+    fprintf(stderr, "  -v, --view=FPS     gnuplotで1秒にFPS枚まで表示する(計算は待たない)\n");
+    fprintf(stderr, "  -H, --headless     絵を描かず待たずに計算し、最後に速さ(と近似解法の力の誤差)を表示する\n");
+    fprintf(stderr, "  -i, --integrator=NAME 積分法 (%s, leapfrog, yoshida4, forest-ruth)\n", method->name);
+}
+
+/* 初期条件をファイルから読む **********************************************/
+static int load_stars(runner *run, const char *path)
+{
+    bodies b;
+
+    bodies_init(&b);
+    if (ic_load(path, &b) != 0) {
+        bodies_free(&b);
+        return -1;
+    }
+    nb_resize(&run->sim, b.n);
+    for (int i = 0; i < b.n; i++) {
+        const double r[3] = {b.x[i], b.y[i], b.z[i]};
+        const double v[3] = {b.vx[i], b.vy[i], b.vz[i]};
+        nb_set_star(&run->sim, i, b.m[i], r, v);
+    }
+    bodies_free(&b);
+    return 0;
+}
+
+/* 星を計算用の配列に写す **************************************************/
+static void set_stars(runner *run, const struct star *s, const int n)
+{
+    nb_resize(&run->sim, n);
+    for (int i = 0; i < n; i++) {
+        nb_set_star(&run->sim, i, s[i].m, s[i].r, s[i].v);
+    }
+}
+
+/* force.cで加速度を求める(nb_simから呼ばれる) *****************************/
+static void accel_force(void *arg, int n, const double *m, const double *r, double *a)
+{
+    force_accel((const force_param *) arg, n, m, (const double (*)[3]) r, (double (*)[3]) a);
+}
+
+/* 出力する時刻 ************************************************************/
+static void output_point(runner *run, const double t, const long step)
+{
+    if (!run->headless || run->use_snap || run->use_diag) {
+        capture_frame(run, t, step);
+    } else {
+        //何も書かないときも力の誤差は測る(最後にreport_runで表示する)
+        double rms, max;
+        measure_force_error(run, &rms, &max);
+    }
+}
+
+/* 星の状態を写して出力のスレッドに渡す **********************************/
+static void capture_frame(runner *run, const double t, const long step)
+{
+    out_frame *f = out_acquire(&run->writer, run->sim.n); //フレームが全て使用中のときだけ待つ
+
+    f->t = t;
+    f->step = step;
+    memcpy(f->id, run->star_id, sizeof(int) * (size_t) run->sim.n);
+    memcpy(f->m, run->sim.m, sizeof(double) * (size_t) run->sim.n);
+    memcpy(f->r, run->sim.r, sizeof(double) * 3 * (size_t) run->sim.n);
+    memcpy(f->v, run->sim.v, sizeof(double) * 3 * (size_t) run->sim.n);
+    f->has_error = measure_force_error(run, &f->error_rms, &f->error_max);
+    measure_diag(run, f);
+    out_submit(&run->writer, f);
+}
+
+/* 出力のスレッドで書き出す ************************************************/
+static void output_frame(const out_frame *f, void *arg)
+{
+    runner *run = (runner *) arg;
+
+    if (run->use_snap) { //絵を描かないので待たない
+        if (snap_write(&run->snap, f->t, f->step, f->n, f->id, f->m,
+                       (const double (*)[3]) f->r, (const double (*)[3]) f->v) != 0) {
+            exit(1);
+        }
+    } else if (!run->headless) {
+        plot_stars(run->fp, f);
+    }
+    if (f->has_diag) {
+        diag_write(&run->diag, f->t, f->step, &f->diag);
+    }
+    if (f->has_error && !run->headless) { //-Hのときは最後にまとめて表示する
+        printf("force error (%s, theta = %g, order = %d): rms = %.3e, max = %.3e\n",
+               force_solver_name(run->force.solver), run->force.theta, run->force.order,
+               f->error_rms, f->error_max);
+    }
+    if (!run->use_snap && !run->headless) {
+        usleep(200 * 1000);
+    }
+}
+
+/* 近似解法の力の誤差を測る ************************************************/
+static int measure_force_error(runner *run, double *rms, double *max)
+{
+    struct timespec start, end;
+
+    if ((run->force.solver == SOLVER_DIRECT && !run->force.mixed) || run->force.solver == SOLVER_PM) return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    force_error(&run->force, run->sim.n, run->sim.m, (const double (*)[3]) run->sim.r, 32, rms, max);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    run->error_time += (double) (end.tv_sec - start.tv_sec) + 1e-9 * (double) (end.tv_nsec - start.tv_nsec);
+    run->nerror++;
+    run->error_sum2 += *rms * *rms;
+    if (*max > run->error_max) run->error_max = *max;
+    return 1;
+}
+
+/* チェックポイント ********************************************************/
+typedef struct {
+    double t;    //次のステップの時刻
+    long step;   //次のステップの番号
+    double dt;
+    int mode;    //0: 元の方法, 1: シンプレクティック積分法, 2: ブロック時間刻み
+    int nstars;
+    int ndead;
+    char method[16]; //積分法の名前(元の方法の名前, シンプレクティック積分法の名前, "block")
+    //力の計算の設定(force_paramと同じ)
+    int solver;
+    double eps, theta;
+    int order, mixed, symmetric, grid;
+    double box;
+} run_state;
+
+/* modeで使う積分法の名前 */
+static const char *stepper_name(const runner *run, const int mode)
+{
+    if (mode == 2) return "block";
+    if (mode == 1) return integ_name(run->integ.type);
+    return run->method->name;
+}
+
+static int save_checkpoint(runner *run, const char *path, const double t, const long step, const double dt, const int mode)
+{
+    ckpt_writer w;
+    run_state rs;
+
+    //星はstruct starの並びに詰め直して書く
+    struct star *s = (struct star *) malloc(sizeof(struct star) * (size_t) (run->sim.n > 0 ? run->sim.n : 1));
+    if (s == NULL) {
+        fprintf(stderr, "error: cannot allocate stars.\n");
+        return -1;
+    }
+    for (int i = 0; i < run->sim.n; i++) {
+        s[i].m = run->sim.m[i];
+        memcpy(s[i].r, &run->sim.r[3 * i], sizeof(s[i].r));
+        memcpy(s[i].v, &run->sim.v[3 * i], sizeof(s[i].v));
+    }
+
+    if (ckpt_begin(&w, path) != 0) {
+        free(s);
+        return -1;
+    }
+    memset(&rs, 0, sizeof(rs));
+    rs.t = t;
+    rs.step = step;
+    rs.dt = dt;
+    rs.mode = mode;
+    rs.nstars = run->sim.n;
+    rs.ndead = run->ndead;
+    snprintf(rs.method, sizeof(rs.method), "%s", stepper_name(run, mode));
+    rs.solver = (int) run->force.solver;
+    rs.eps = run->force.eps;
+    rs.theta = run->force.theta;
+    rs.order = run->force.order;
+    rs.mixed = run->force.mixed;
+    rs.symmetric = run->force.symmetric;
+    rs.grid = run->force.grid;
+    rs.box = run->force.box;
+    ckpt_put(&w, "run", &rs, sizeof(rs));
+    ckpt_put(&w, "stars", s, sizeof(struct star) * (size_t) run->sim.n);
+    ckpt_put(&w, "star_id", run->star_id, sizeof(int) * (size_t) run->sim.n);
+    if (run->use_diag && run->diag.ready) {
+        ckpt_put(&w, "diag", &run->diag.first, sizeof(run->diag.first));
+    }
+    if (mode == 1) {
+        integ_save(&run->integ, &w);
+    } else if (mode == 2) {
+        block_save(&run->block, &w);
+    }
+    free(s);
+    return ckpt_commit(&w);
+}
+
+static int restore_stars(runner *run)
+{
+    run_state rs;
+
+    if (ckpt_read(&run->ckpt, "run", &rs, sizeof(rs)) != 0 || rs.nstars < 0) return -1;
+    struct star *s = (struct star *) malloc(sizeof(struct star) * (size_t) (rs.nstars > 0 ? rs.nstars : 1));
+    run->star_id = (int *) malloc(sizeof(int) * (size_t) (rs.nstars > 0 ? rs.nstars : 1));
+    if (s == NULL || run->star_id == NULL) {
+        fprintf(stderr, "error: cannot allocate stars.\n");
+        exit(1);
+    }
+    run->ndead = rs.ndead;
+    if (ckpt_read(&run->ckpt, "stars", s, sizeof(struct star) * (size_t) rs.nstars) != 0 ||
+        ckpt_read(&run->ckpt, "star_id", run->star_id, sizeof(int) * (size_t) rs.nstars) != 0) {
+        free(s);
+        return -1;
+    }
+    set_stars(run, s, rs.nstars);
+    free(s);
+    return 0;
+}
+
+/* 同じ積分法, 同じdt, 同じ力の計算の設定で書いたものでなければ, 違いを表示して-1 */
+static int restore_run(runner *run, double *t, long *step, const double dt, const int mode)
+{
+    const force_param *p = &run->force;
+    const char *name = stepper_name(run, mode);
+    run_state rs;
+
+    if (ckpt_read(&run->ckpt, "run", &rs, sizeof(rs)) != 0) return -1;
+    rs.method[sizeof(rs.method) - 1] = '\0';
+    if (rs.mode != mode || strcmp(rs.method, name) != 0 || rs.dt != dt) {
+        fprintf(stderr, "error: checkpoint was written with %s, dt = %g (now %s, dt = %g).\n",
+                rs.method, rs.dt, name, dt);
+        return -1;
+    }
+    if (rs.solver != (int) p->solver || rs.eps != p->eps || rs.theta != p->theta || rs.order != p->order ||
+        rs.mixed != p->mixed || rs.symmetric != p->symmetric || rs.grid != p->grid || rs.box != p->box) {
+        fprintf(stderr, "error: checkpoint was written with solver %s, eps = %g, theta = %g, order = %d, "
+                "mixed = %d, symmetric = %d, grid = %d, box = %g.\n",
+                rs.solver >= 0 && rs.solver <= SOLVER_PM ? force_solver_name((solver_type) rs.solver) : "?",
+                rs.eps, rs.theta, rs.order, rs.mixed, rs.symmetric, rs.grid, rs.box);
+        return -1;
+    }
+    if (mode == 1 && integ_restore(&run->integ, &run->ckpt) != 0) return -1;
+    if (mode == 2 && block_restore(&run->block, &run->ckpt) != 0) return -1;
+    *t = rs.t;
+    *step = rs.step;
+    return 0;
+}
+
+/* 保存量を測る ************************************************************/
+static void measure_diag(runner *run, out_frame *f)
+{
+    if (!run->use_diag) return;
+
+    diag_measure(&run->force, run->sim.n, run->sim.m, (const double (*)[3]) run->sim.r, (const double (*)[3]) run->sim.v, &f->diag);
+    f->has_diag = 1;
+}
+
+/* 実行の速さを表示 ********************************************************/
+static void report_run(runner *run, const long steps, const double wall)
+{
+    force_count c;
+
+    force_get_count(&run->force, &c);
+    printf("run: %d stars left, %ld steps in %.3f s (%.1f steps/s)\n",
+           run->sim.n - run->ndead, steps, wall, steps / wall);
+    printf("force (%s): %ld evaluations, %lld stars\n",
+           force_solver_name(run->force.solver), c.ncall, c.nbody);
+    if (run->force.solver == SOLVER_PM) {
+        printf("mesh: %.3e cells, %.3e cells/s\n", c.ncell, c.ncell / wall);
+    } else {
+        printf("interactions: %.3e evaluated, %.3e interactions/s\n", c.ninteract, c.ninteract / wall);
+    }
+    printf("direct-sum equivalent: %.3e pairs, %.3e pairs/s\n", c.ndirect, c.ndirect / wall);
+    if (run->nerror > 0) {
+        //時間には誤差を測った分(32個の星の直接計算, FMMは全体の計算一回)も含む
+        printf("force error (%s, theta = %g, order = %d): rms = %.3e, max = %.3e over %d checks (%.3f s)\n",
+               force_solver_name(run->force.solver), run->force.theta, run->force.order,
+               sqrt(run->error_sum2 / run->nerror), run->error_max, run->nerror, run->error_time);
+    }
+    printf("output: waited %ld times for a free frame\n", run->writer.nwait);
+}
+
+/* star書き出し ************************************************************/
+static void plot_stars(FILE *fp, const out_frame *f)
+{
+    int i;
+    char space[WIDTH][HEIGHT];
+
+    memset(space, ' ', sizeof(space));
+    for (i = 0; i < f->n; i++) {
+        if(f->m[i] == 0) continue;
+        const int x = WIDTH  / 2 + (int) f->r[i][0];
+        const int y = HEIGHT / 2 + (int) f->r[i][1];
+        if (x < 0 || x >= WIDTH)  continue;
+        if (y < 0 || y >= HEIGHT) continue;
+        char c = 'o';
+        if (f->m[i] >= 1.0) c = 'O';
+        space[x][y] = c;
+    }
+
+    int x, y;
+    fprintf(fp, "----------\n");
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++)
+            fputc(space[x][y], fp);
+        fputc('\n', fp);
+    }
+    fflush(fp);
+
+    printf("----t = %5.1f----\n", f->t);
+    for (i = 0; i < f->n; i++) {
+        printf("stars[%d]:\n\tr = ", f->id[i]);
+        nb_print_vector(VECTORSIZE, f->r[i]);
+        printf("\tv = ");
+        nb_print_vector(VECTORSIZE, f->v[i]);
+        printf("\n");
+    }
+    printf("\n");
+}
+
+/* 座標更新 ****************************************************************/
+static void update_positions(runner *run, const double dt)
+{
+    //gravity3.c はオイラー法, gravity3_RK4.c は四次のルンゲクッタ法
+    run->method->step(&run->sim, dt);
+    wrap_stars(run);
+
+    merge_stars(run);
+}
+
+/* ブロック時間刻みで座標と速度を更新 **************************************/
+static void update_block(runner *run)
+{
+    block_step(&run->block, &run->force, run->sim.n, run->sim.m, (double (*)[3]) run->sim.r, (double (*)[3]) run->sim.v);
+    wrap_stars(run);
+
+    //質量が変わると加速度も変わるので、全ての星を求め直す
+    if (merge_stars(run) > 0) {
+        block_reset(&run->block);
+    }
+}
+
+/* シンプレクティック積分法で座標と速度を更新 ******************************/
+static void update_symplectic(runner *run, const double dt)
+{
+    integ_step(&run->integ, &run->force, run->sim.n, run->sim.m, (double (*)[3]) run->sim.r, (double (*)[3]) run->sim.v, dt);
+    wrap_stars(run);
+
+    if (merge_stars(run) > 0) {
+        integ_reset(&run->integ);
+    }
+}
+
+/* 周期境界 ****************************************************************/
+static void wrap_stars(runner *run)
+{
+    //PMでは箱から出た星を反対側に戻す(力は周期で求めているので変わらない)
+    if (run->force.solver != SOLVER_PM) return;
+    for (int i = 0; i < run->sim.n; i++) {
+        pm_wrap(run->force.box, &run->sim.r[3 * i]);
+    }
+}
+
+/* 星の融合 ****************************************************************/
+static int merge_stars(runner *run)
+{
+    //質量は和, 座標は重心, 速度は運動量を保存するように、その場で融合する
+    const int merged = collide_merge(&run->coll, run->sim.n, run->sim.m, (double (*)[3]) run->sim.r,
+                                     (double (*)[3]) run->sim.v, R);
+    if (merged == 0) return 0;
+
+    //消えた星が1/8を超えたら詰める(融合した後は加速度を求め直すので、番号が変わってもよい)
+    run->ndead += merged;
+    if (run->ndead * 8 >= run->sim.n) {
+        compact_stars(run);
+    }
+    return merged;
+}
+
+/* 消えた星を詰める ********************************************************/
+static void compact_stars(runner *run)
+{
+    int i, k = 0;
+
+    //順序を保ったまま、生きている星を前に寄せる
+    for (i = 0; i < run->sim.n; i++) {
+        if (run->sim.m[i] == 0) continue;
+        run->sim.m[k] = run->sim.m[i];
+        memmove(&run->sim.r[3 * k], &run->sim.r[3 * i], sizeof(double) * 3);
+        memmove(&run->sim.v[3 * k], &run->sim.v[3 * i], sizeof(double) * 3);
+        run->star_id[k] = run->star_id[i];
+        k++;
+    }
+    nb_resize(&run->sim, k);
+    run->ndead = 0;
+}
+
+static FILE *gnuplot_open() {
+    FILE *gp;
+    if((gp = popen("gnuplot", "w")) == NULL) {
+        fprintf(stderr, "error: cannot open gnuplot.\n");
+        return NULL;
+    }
+    fprintf(gp, "set xrange [%e:%e]\n", (double) -WIDTH, (double) WIDTH);
+    fprintf(gp, "set yrange [%e:%e]\n", (double) -HEIGHT, (double) HEIGHT);
+    fprintf(gp, "set zrange [%e:%e]\n", (double) -ZRANGE, (double) ZRANGE);
+
+    fprintf(gp, "set size square\n");
+
+    return gp;
+}
+
+/* gnuplotの入出力を閉じる *************************************************/
+static void gnuplot_close(FILE *gp) {
+    pclose(gp);
+}
+
+/* gnuplotに星の座標を渡す ************************************************/
+static void view_stars(runner *run) {
+    float *buf = lv_buffer(&run->view, run->sim.n);
+    int k = 0;
+    for(int i = 0; i < run->sim.n; i++) {
+        if(run->sim.m[i] == 0) continue;
+        buf[3 * k + 0] = (float) run->sim.r[3 * i + 0];
+        buf[3 * k + 1] = (float) run->sim.r[3 * i + 1];
+        buf[3 * k + 2] = (float) run->sim.r[3 * i + 2];
+        k++;
+    }
+    lv_publish(&run->view, k);
+}
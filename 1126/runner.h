@@ -0,0 +1,22 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "nbody.h"
+
+/*
+ * 3次元の計算の実行(gravity3.c, gravity3_RK4.c から共通で使う)
+ * コマンドライン引数の解釈、初期条件とチェックポイントの読み書き、出力のスレッドへの受け渡し、
+ * -Hのときの速さの表示を行う。二つのプログラムで違うのは -i, -b を指定しないときの積分法だけなので、
+ * それを runner_method で渡す。
+ * 計算の状態(星, 出力先, 力の計算の作業領域など)は runner_main の中の一つの構造体にまとめて持つ。
+ */
+
+typedef struct {
+    const char *name; //-iで選ぶときの名前
+    void (*step)(nb_sim *s, double dt); //dtだけ進める(質量0の星は動かさないこと)
+} runner_method;
+
+/* argc, argvのとおりに計算する。mainの戻り値を返す */
+int runner_main(int argc, char *argv[], const runner_method *method);
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * スナップショットの中身を表示する。
+ * 使い方: snapdump FILE       スナップショットの一覧
+ *         snapdump FILE K     K番目のスナップショットの星
+ * コンパイル: gcc -O2 snapdump.c snapshot.c -o snapdump
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "snapshot.h"
+
+int main(int argc, char *argv[])
+{
+    snap_reader rd;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s FILE [K]\n", argv[0]);
+        return 1;
+    }
+    if (snap_map(&rd, argv[1]) != 0) {
+        return 1;
+    }
+
+    if (argc < 3) {
+        for (long k = 0; k < rd.nsnap; k++) {
+            double t;
+            long n;
+            snap_get(&rd, k, &t, &n);
+            printf("%ld\tt = %g\tn = %ld\n", k, t, n);
+        }
+    } else {
+        double t;
+        long n;
+        const snap_record *s = snap_get(&rd, atol(argv[2]), &t, &n);
+        if (s == NULL) {
+            fprintf(stderr, "error: no snapshot %s.\n", argv[2]);
+            snap_unmap(&rd);
+            return 1;
+        }
+        printf("# t = %g\n# id, m, x, y, z, vx, vy, vz\n", t);
+        for (long i = 0; i < n; i++) {
+            printf("%lld, %.17g, %.17g, %.17g, %.17g, %.17g, %.17g, %.17g\n", s[i].id, s[i].m,
+                   s[i].r[0], s[i].r[1], s[i].r[2], s[i].v[0], s[i].v[1], s[i].v[2]);
+        }
+    }
+    snap_unmap(&rd);
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+#define SNAP_BUF 4096 //一度にfwriteする星の数
+
+/* 書き込み ****************************************************************/
+int snap_open(snap_writer *w, const char *path)
+{
+    snap_file_header h;
+
+    w->index = NULL;
+    w->nsnap = 0;
+    w->cap = 0;
+    w->buf = NULL;
+    if ((w->fp = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "error: cannot open %s.\n", path);
+        return -1;
+    }
+    setvbuf(w->fp, NULL, _IOFBF, 1 << 22);
+    w->buf = (snap_record *) malloc(sizeof(snap_record) * SNAP_BUF);
+    if (w->buf == NULL) {
+        fprintf(stderr, "error: cannot allocate snapshot buffer.\n");
+        fclose(w->fp);
+        return -1;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, 8);
+    h.record_size = sizeof(snap_record);
+    if (fwrite(&h, sizeof(h), 1, w->fp) != 1) {
+        fprintf(stderr, "error: cannot write %s.\n", path);
+        fclose(w->fp);
+        free(w->buf);
+        return -1;
+    }
+    w->offset = sizeof(h);
+    return 0;
+}
+
+int snap_write(snap_writer *w, double t, long step, int n, const int *id,
+               const double *m, const double (*r)[3], const double (*v)[3])
+{
+    if (w->nsnap == w->cap) {
+        w->cap = w->cap ? 2 * w->cap : 64;
+        w->index = (snap_index_entry *) realloc(w->index, sizeof(snap_index_entry) * (size_t) w->cap);
+        if (w->index == NULL) {
+            fprintf(stderr, "error: cannot allocate snapshot index.\n");
+            return -1;
+        }
+    }
+    snap_index_entry *e = &w->index[w->nsnap++];
+    e->offset = w->offset;
+    e->t = t;
+    e->n = (unsigned long long) n;
+
+    snap_header h;
+    memset(&h, 0, sizeof(h));
+    h.t = t;
+    h.step = (unsigned long long) step;
+    h.n = (unsigned long long) n;
+    if (fwrite(&h, sizeof(h), 1, w->fp) != 1) return -1;
+
+    //SNAP_BUF個ずつ詰めてから書く
+    for (int i0 = 0; i0 < n; i0 += SNAP_BUF) {
+        const int i1 = i0 + SNAP_BUF < n ? i0 + SNAP_BUF : n;
+        for (int i = i0; i < i1; i++) {
+            snap_record *q = &w->buf[i - i0];
+            q->id = id != NULL ? id[i] : i;
+            q->m = m[i];
+            memcpy(q->r, r[i], sizeof(q->r));
+            memcpy(q->v, v[i], sizeof(q->v));
+        }
+        if (fwrite(w->buf, sizeof(snap_record), (size_t) (i1 - i0), w->fp) != (size_t) (i1 - i0)) {
+            fprintf(stderr, "error: cannot write snapshot.\n");
+            return -1;
+        }
+    }
+    w->offset += sizeof(h) + sizeof(snap_record) * (unsigned long long) n;
+    return 0;
+}
+
+int snap_close(snap_writer *w)
+{
+    snap_file_header h;
+    int result = 0;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, 8);
+    h.record_size = sizeof(snap_record);
+    h.nsnap = (unsigned long long) w->nsnap;
+    h.index_offset = w->offset;
+    if (fwrite(w->index, sizeof(snap_index_entry), (size_t) w->nsnap, w->fp) != (size_t) w->nsnap ||
+        fseek(w->fp, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, w->fp) != 1) {
+        result = -1;
+    }
+    if (fclose(w->fp) != 0) result = -1;
+    if (result != 0) fprintf(stderr, "error: cannot write snapshot index.\n");
+    free(w->index);
+    free(w->buf);
+    w->fp = NULL;
+    w->index = NULL;
+    w->buf = NULL;
+    return result;
+}
+
+/* 読み込み ****************************************************************/
+
+/* 索引がないときは snap_header をたどって作る */
+static int rebuild_index(snap_reader *rd)
+{
+    unsigned long long offset = sizeof(snap_file_header);
+    long cap = 0;
+
+    rd->nsnap = 0;
+    while (offset + sizeof(snap_header) <= rd->size) {
+        snap_header h;
+        memcpy(&h, rd->data + offset, sizeof(h));
+        const unsigned long long bytes = sizeof(h) + h.n * sizeof(snap_record);
+        if (h.n > rd->size / sizeof(snap_record) || offset + bytes > rd->size) break; //途中で切れている
+        if (rd->nsnap == cap) {
+            cap = cap ? 2 * cap : 64;
+            rd->index = (snap_index_entry *) realloc(rd->index, sizeof(snap_index_entry) * (size_t) cap);
+            if (rd->index == NULL) return -1;
+        }
+        rd->index[rd->nsnap].offset = offset;
+        rd->index[rd->nsnap].t = h.t;
+        rd->index[rd->nsnap].n = h.n;
+        rd->nsnap++;
+        offset += bytes;
+    }
+    return 0;
+}
+
+int snap_map(snap_reader *rd, const char *path)
+{
+    struct stat st;
+    snap_file_header h;
+
+    rd->data = NULL;
+    rd->index = NULL;
+    rd->nsnap = 0;
+    if ((rd->fd = open(path, O_RDONLY)) < 0) {
+        fprintf(stderr, "error: cannot open %s.\n", path);
+        return -1;
+    }
+    if (fstat(rd->fd, &st) != 0 || (size_t) st.st_size < sizeof(h)) {
+        fprintf(stderr, "error: %s is not a snapshot file.\n", path);
+        close(rd->fd);
+        return -1;
+    }
+    rd->size = (size_t) st.st_size;
+    void *p = mmap(NULL, rd->size, PROT_READ, MAP_SHARED, rd->fd, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "error: cannot map %s.\n", path);
+        close(rd->fd);
+        return -1;
+    }
+    rd->data = (const char *) p;
+
+    memcpy(&h, rd->data, sizeof(h));
+    if (memcmp(h.magic, SNAP_MAGIC, 8) != 0 || h.record_size != sizeof(snap_record)) {
+        fprintf(stderr, "error: %s is not a snapshot file.\n", path);
+        snap_unmap(rd);
+        return -1;
+    }
+
+    if (h.index_offset != 0 &&
+        h.index_offset + h.nsnap * sizeof(snap_index_entry) <= rd->size) {
+        rd->nsnap = (long) h.nsnap;
+        rd->index = (snap_index_entry *) malloc(sizeof(snap_index_entry) * (size_t) (rd->nsnap + 1));
+        if (rd->index == NULL) {
+            snap_unmap(rd);
+            return -1;
+        }
+        memcpy(rd->index, rd->data + h.index_offset, sizeof(snap_index_entry) * (size_t) rd->nsnap);
+    } else if (rebuild_index(rd) != 0) {
+        snap_unmap(rd);
+        return -1;
+    }
+    return 0;
+}
+
+void snap_unmap(snap_reader *rd)
+{
+    if (rd->data != NULL) munmap((void *) rd->data, rd->size);
+    close(rd->fd);
+    free(rd->index);
+    rd->data = NULL;
+    rd->index = NULL;
+    rd->nsnap = 0;
+}
+
+const snap_record *snap_get(const snap_reader *rd, long k, double *t, long *n)
+{
+    if (k < 0 || k >= rd->nsnap) return NULL;
+    const snap_index_entry *e = &rd->index[k];
+    if (t != NULL) *t = e->t;
+    if (n != NULL) *n = (long) e->n;
+    return (const snap_record *) (rd->data + e->offset + sizeof(snap_header));
+}
@@ -0,0 +1,85 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * 軌道のスナップショットのバイナリ形式
+ *   snap_file_header
+ *   スナップショットごとに snap_header と n 個の snap_record (64バイト固定)
+ *   最後に索引(スナップショットごとの snap_index_entry)
+ * 索引の位置はファイルの先頭に書くので、読むときはメモリに写像して
+ * 好きなスナップショットをすぐに取り出せる。閉じる前に止まって索引がないときは、
+ * snap_header を順にたどって作り直す。
+ * 数はすべてこの計算機のバイト順で書く。
+ */
+
+#define SNAP_MAGIC "NBSNAP01"
+
+typedef struct {
+    char magic[8];                //SNAP_MAGIC
+    unsigned long long record_size; //sizeof(snap_record)
+    unsigned long long nsnap;      //スナップショットの数(閉じたときに書く)
+    unsigned long long index_offset; //索引の位置(閉じたときに書く, 0なら索引なし)
+} snap_file_header;
+
+typedef struct {
+    double t;                //時刻
+    unsigned long long step; //ステップ数
+    unsigned long long n;    //星の数
+} snap_header;
+
+typedef struct {
+    long long id;  //星の元の番号
+    double m;
+    double r[3];
+    double v[3];
+} snap_record;
+
+typedef struct {
+    unsigned long long offset; //snap_headerの位置
+    double t;
+    unsigned long long n;
+} snap_index_entry;
+
+/* 書き込み ****************************************************************/
+typedef struct {
+    FILE *fp;
+    unsigned long long offset; //次に書く位置
+    snap_index_entry *index;
+    long nsnap;
+    long cap;
+    snap_record *buf; //まとめて書くための領域
+} snap_writer;
+
+/* pathを新しく作って開く。失敗したら-1 */
+int snap_open(snap_writer *w, const char *path);
+
+/*
+ * n個の星を1つのスナップショットとして書く。idがNULLなら0からの番号を使う。
+ * 失敗したら-1
+ */
+int snap_write(snap_writer *w, double t, long step, int n, const int *id,
+               const double *m, const double (*r)[3], const double (*v)[3]);
+
+/* 索引を書いて閉じる。失敗したら-1 */
+int snap_close(snap_writer *w);
+
+/* 読み込み ****************************************************************/
+typedef struct {
+    const char *data; //写像したファイル
+    size_t size;
+    int fd;
+    long nsnap;
+    snap_index_entry *index;
+} snap_reader;
+
+/* pathを読み込み用に写像する。失敗したらメッセージを表示して-1 */
+int snap_map(snap_reader *rd, const char *path);
+void snap_unmap(snap_reader *rd);
+
+/* k番目のスナップショットの星の並びを返す(写像した領域を直接指す)。t, nがNULLでなければ入れる */
+const snap_record *snap_get(const snap_reader *rd, long k, double *t, long *n);
+
+#endif